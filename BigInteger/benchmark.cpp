@@ -0,0 +1,233 @@
+// Scaling benchmarks for BigInt, operand sizes in limbs. The repository has
+// no build system, so there is no target for this file; build and run it with
+//   g++ -std=c++17 -O2 benchmark.cpp big_integer.cpp -lbenchmark -pthread
+//   ./a.out --benchmark_out=big_integer.json --benchmark_out_format=json
+// Sizes go up to 2^20 limbs, except where the algorithm is quadratic:
+// Divide, Modulo, Isqrt and IRoot stop at 2^15 limbs and Gcd and ExtendedGcd
+// at 2^12. Reduce covers division by a fixed divisor through Barrett
+// reduction in ModularContext up to 2^20 limbs.
+#include "big_integer.hpp"
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const int kMaxLimbs = 1 << 20;
+// Division is still quadratic in the divisor size, larger runs take minutes.
+// Isqrt and IRoot divide in every Newton step and share the cap.
+const int kMaxDivisionLimbs = 1 << 15;
+// Lehmer's GCD is quadratic with a larger constant.
+const int kMaxGcdLimbs = 1 << 12;
+
+BigInt Random(int limbs, uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  BigInt big;
+  big.Data().resize(limbs);
+  for (int i = 0; i < limbs; ++i) {
+    big.Data()[i] = gen();
+  }
+  big.Data()[limbs - 1] |= 1;
+  big.Size() = limbs;
+  return big;
+}
+
+void Sizes(benchmark::internal::Benchmark* bench, int max_limbs) {
+  bench->RangeMultiplier(4)->Range(1, max_limbs)->Complexity();
+}
+
+void BM_FromString(benchmark::State& state) {
+  std::ostringstream out;
+  out << Random(state.range(0), 1);
+  std::string digits = out.str();
+  for (auto _ : state) {
+    BigInt big(digits);
+    benchmark::DoNotOptimize(big);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FromString)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Print(benchmark::State& state) {
+  BigInt big = Random(state.range(0), 1);
+  for (auto _ : state) {
+    std::ostringstream out;
+    out << big;
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Print)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Add(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = left + right;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Add)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Subtract(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = left - right;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Subtract)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Multiply(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = left * right;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Multiply)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Square(benchmark::State& state) {
+  BigInt big = Random(state.range(0), 1);
+  for (auto _ : state) {
+    BigInt res = big * big;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Square)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+// A 2n-limb dividend over an n-limb divisor.
+void BM_Divide(benchmark::State& state) {
+  BigInt dividend = Random(2 * state.range(0), 1);
+  BigInt divisor = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = dividend / divisor;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Divide)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxDivisionLimbs);
+});
+
+void BM_Modulo(benchmark::State& state) {
+  BigInt dividend = Random(2 * state.range(0), 1);
+  BigInt divisor = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = dividend % divisor;
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Modulo)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxDivisionLimbs);
+});
+
+// A 2n-limb value reduced by an n-limb modulus whose reciprocal is computed
+// once outside the loop, so each iteration is a few n-limb products.
+void BM_Reduce(benchmark::State& state) {
+  BigInt value = Random(2 * state.range(0), 1);
+  ModularContext context(Random(state.range(0), 2));
+  for (auto _ : state) {
+    BigInt res = context.Reduce(value);
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Reduce)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+void BM_Isqrt(benchmark::State& state) {
+  BigInt big = Random(2 * state.range(0), 1);
+  BigInt root;
+  for (auto _ : state) {
+    BigInt::Isqrt(big, root);
+    benchmark::DoNotOptimize(root);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Isqrt)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxDivisionLimbs);
+});
+
+// Cube roots, a 3n-limb value.
+void BM_IRoot(benchmark::State& state) {
+  BigInt big = Random(3 * state.range(0), 1);
+  BigInt root;
+  for (auto _ : state) {
+    BigInt::IRoot(big, 3, root);
+    benchmark::DoNotOptimize(root);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_IRoot)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxDivisionLimbs);
+});
+
+void BM_Gcd(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = Random(state.range(0), 2);
+  for (auto _ : state) {
+    BigInt res = BigInt::Gcd(left, right);
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Gcd)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxGcdLimbs);
+});
+
+void BM_ExtendedGcd(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = Random(state.range(0), 2);
+  BigInt left_coef;
+  BigInt right_coef;
+  for (auto _ : state) {
+    BigInt res = BigInt::ExtendedGcd(left, right, left_coef, right_coef);
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ExtendedGcd)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxGcdLimbs);
+});
+
+// Equal except in the lowest limb, so the comparison reads every limb.
+void BM_Compare(benchmark::State& state) {
+  BigInt left = Random(state.range(0), 1);
+  BigInt right = left;
+  ++right;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(left < right);
+    benchmark::DoNotOptimize(left == right);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Compare)->Apply([](benchmark::internal::Benchmark* bench) {
+  Sizes(bench, kMaxLimbs);
+});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,422 +1,3047 @@
 #include "big_integer.hpp"
 
-BigInt::BigInt() {}
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
-BigInt::BigInt(int64_t big) {
-  is_negative_ = false;
-  size_ = 0;
-  uint64_t bigint = llabs(big);
-  if (big == -INT64_MIN) {
-    bigint = -INT64_MIN;
+namespace {
+
+using Limb = BigInt::Limb;
+using DoubleLimb = unsigned __int128;
+
+// Limb counts up to which radix conversion uses the quadratic base case, and
+// from which reciprocals come from Newton iteration and division by a fixed
+// power of the radix goes through Barrett reduction.
+const int kRadixThreshold = 32;
+const int kReciprocalThreshold = 64;
+const int kBarrettThreshold = 64;
+
+// res = left + right for left_size >= right_size, returns the carry out.
+// res may alias left.
+Limb AddLimbs(Limb* res, const Limb* left, int left_size, const Limb* right,
+              int right_size) {
+  Limb carry = 0;
+  int i = 0;
+  for (; i < right_size; ++i) {
+    Limb sum = left[i] + carry;
+    carry = static_cast<Limb>(sum < carry);
+    sum += right[i];
+    carry += static_cast<Limb>(sum < right[i]);
+    res[i] = sum;
   }
-  if (big < 0) {
-    is_negative_ = true;
+  for (; i < left_size; ++i) {
+    res[i] = left[i] + carry;
+    carry = static_cast<Limb>(res[i] < carry);
   }
-  int itr = 0;
-  if (bigint != 0) {
-    ++size_;
+  return carry;
+}
+
+// res = left - right for left >= right, returns the borrow out.
+// res may alias left.
+Limb SubLimbs(Limb* res, const Limb* left, int left_size, const Limb* right,
+              int right_size) {
+  Limb borrow = 0;
+  int i = 0;
+  for (; i < right_size; ++i) {
+    Limb diff = left[i] - right[i];
+    Limb next = static_cast<Limb>(left[i] < right[i]);
+    next += static_cast<Limb>(diff < borrow);
+    res[i] = diff - borrow;
+    borrow = next;
   }
-  biginteger_.push_back(0);
-  while (bigint / kSystcomp > 0) {
-    biginteger_.push_back(0);
-    ++size_;
-    biginteger_[itr + 1] = bigint / kSystcomp;
-    biginteger_[itr] = bigint % kSystcomp;
-    bigint /= kSystcomp;
-    ++itr;
+  for (; i < left_size; ++i) {
+    Limb next = static_cast<Limb>(left[i] < borrow);
+    res[i] = left[i] - borrow;
+    borrow = next;
   }
-  biginteger_[itr] = bigint % kSystcomp;
+  return borrow;
 }
 
-BigInt::BigInt(std::string bigstring) {
-  is_negative_ = false;
-  if (bigstring[0] == '-') {
-    is_negative_ = true;
+int CompareLimbs(const Limb* left, int left_size, const Limb* right,
+                 int right_size) {
+  if (left_size != right_size) {
+    return left_size < right_size ? -1 : 1;
   }
-  int minus = static_cast<int>(is_negative_);
-  int pointer = bigstring.size();
-  int iterator = 0;
-  size_ = 0;
-  while (pointer - kCellsize - minus > 0) {
-    biginteger_.push_back(
-        stoi(bigstring.substr(pointer - kCellsize, kCellsize)));
-    ++iterator;
-    if (stoi(bigstring.substr(pointer - kCellsize, kCellsize)) != 0) {
-      size_ = iterator;
-    }
-    pointer -= kCellsize;
+  int i = left_size - 1;
+  while (i >= 0 && left[i] == right[i]) {
+    --i;
   }
-  if (stoi(bigstring.substr(minus, pointer)) != 0) {
-    biginteger_.push_back(stoi(bigstring.substr(minus, pointer - minus)));
-    size_ = ++iterator;
+  if (i < 0) {
+    return 0;
   }
+  return static_cast<int>(left[i] > right[i]) -
+         static_cast<int>(left[i] < right[i]);
 }
 
-std::vector<int64_t>& BigInt::Data() { return biginteger_; }
-
-std::vector<int64_t> BigInt::Data() const { return biginteger_; }
+// res[0, size) = big << shift for 0 <= shift < 64, returns the bits shifted
+// out of the top limb. res may overlap big from above.
+Limb ShiftLeftLimbs(Limb* res, const Limb* big, int size, int shift) {
+  if (shift == 0) {
+    std::copy_backward(big, big + size, res + size);
+    return 0;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  Limb out = big[size - 1] >> (64 - shift);
+  for (int i = size - 1; i > 0; --i) {
+    res[i] = (big[i] << shift) | (big[i - 1] >> (64 - shift));
+  }
+  res[0] = big[0] << shift;
+  return out;
+}
 
-int& BigInt::Size() { return size_; }
+// res[0, size) = big >> shift for 0 <= shift < 64, returns the bits shifted
+// out of the bottom limb in its high end. res may overlap big from below.
+Limb ShiftRightLimbs(Limb* res, const Limb* big, int size, int shift) {
+  if (shift == 0) {
+    std::copy(big, big + size, res);
+    return 0;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  Limb out = big[0] << (64 - shift);
+  for (int i = 0; i + 1 < size; ++i) {
+    res[i] = (big[i] >> shift) | (big[i + 1] << (64 - shift));
+  }
+  res[size - 1] = big[size - 1] >> shift;
+  return out;
+}
 
-int BigInt::Size() const { return size_; }
+// res[0, left_size + right_size) = left * right, res must not alias inputs.
+void MulLimbs(Limb* res, const Limb* left, int left_size, const Limb* right,
+              int right_size) {
+  std::fill(res, res + left_size + right_size, 0);
+  for (int i = 0; i < left_size; ++i) {
+    Limb carry = 0;
+    for (int j = 0; j < right_size; ++j) {
+      DoubleLimb cur = static_cast<DoubleLimb>(left[i]) * right[j] +
+                       res[i + j] + carry;
+      res[i + j] = static_cast<Limb>(cur);
+      carry = static_cast<Limb>(cur >> 64);
+    }
+    res[i + right_size] = carry;
+  }
+}
 
-bool& BigInt::Negative() { return is_negative_; }
+// res[0, 2 * size) = big * big, cross products are computed once.
+void SqrLimbs(Limb* res, const Limb* big, int size) {
+  std::fill(res, res + 2 * size, 0);
+  for (int i = 0; i < size; ++i) {
+    Limb carry = 0;
+    for (int j = i + 1; j < size; ++j) {
+      DoubleLimb cur =
+          static_cast<DoubleLimb>(big[i]) * big[j] + res[i + j] + carry;
+      res[i + j] = static_cast<Limb>(cur);
+      carry = static_cast<Limb>(cur >> 64);
+    }
+    res[i + size] = carry;
+  }
+  for (int i = 2 * size - 1; i > 0; --i) {
+    res[i] = (res[i] << 1) | (res[i - 1] >> 63);
+  }
+  res[0] <<= 1;
+  Limb carry = 0;
+  for (int i = 0; i < size; ++i) {
+    DoubleLimb square = static_cast<DoubleLimb>(big[i]) * big[i];
+    DoubleLimb cur = static_cast<DoubleLimb>(res[2 * i]) +
+                     static_cast<Limb>(square) + carry;
+    res[2 * i] = static_cast<Limb>(cur);
+    cur = static_cast<DoubleLimb>(res[2 * i + 1]) +
+          static_cast<Limb>(square >> 64) + static_cast<Limb>(cur >> 64);
+    res[2 * i + 1] = static_cast<Limb>(cur);
+    carry = static_cast<Limb>(cur >> 64);
+  }
+}
 
-bool BigInt::Negative() const { return is_negative_; }
+int KaratsubaThreshold() {
+  return std::max(BigInt::GetTuning().karatsuba_threshold, 4);
+}
 
-void BigInt::Swap(BigInt& big) {
-  std::vector<int64_t> tmp1 = biginteger_;
-  int tmp2 = size_;
-  bool tmp3 = is_negative_;
-  biginteger_ = big.biginteger_;
-  size_ = big.size_;
-  is_negative_ = big.is_negative_;
-  big.biginteger_ = tmp1;
-  big.size_ = tmp2;
-  big.is_negative_ = tmp3;
+// Toom-3 splits into thirds and needs the shorter operand to reach into the
+// top third, which balanced operands only do from 5 limbs on. Below that the
+// unbalanced fallback would hand the same sizes back to MultiplyLimbs.
+int Toom3Threshold() {
+  return std::max(BigInt::GetTuning().toom3_threshold, 5);
 }
 
-std::ostream& operator<<(std::ostream& ostream, const BigInt& big) {
-  const int kCellsize = 9;
-  if (big.Size() == 0) {
-    ostream << 0;
-    return ostream;
+// Upper bound on the scratch limbs Karatsuba and KaratsubaSquare need for an
+// operand of the given size.
+int KaratsubaScratch(int size) {
+  int scratch = 0;
+  while (size >= KaratsubaThreshold()) {
+    int half = (size + 1) / 2;
+    scratch += 4 * half + 4;
+    size = half + 1;
   }
-  if (big.Negative()) {
-    ostream << '-';
+  return scratch;
+}
+
+// res[0, left_size + right_size) = left * right for left_size >= right_size.
+void Karatsuba(Limb* res, const Limb* left, int left_size, const Limb* right,
+               int right_size, Limb* scratch) {
+  if (right_size < KaratsubaThreshold()) {
+    MulLimbs(res, left, left_size, right, right_size);
+    return;
   }
-  ostream << big.Data()[big.Size() - 1];
-  for (int i = big.Size() - 2; i >= 0; --i) {
-    std::string insstr = std::to_string(big.Data()[i]);
-    std::string strout(kCellsize - insstr.size(), '0');
-    strout += insstr;
-    ostream << strout;
+  int half = (left_size + 1) / 2;
+  if (right_size <= half) {
+    // Unbalanced operands: multiply right by consecutive right_size pieces.
+    Limb* product = scratch;
+    std::fill(res, res + left_size + right_size, 0);
+    for (int offset = 0; offset < left_size; offset += right_size) {
+      int piece = std::min(right_size, left_size - offset);
+      if (piece == right_size) {
+        Karatsuba(product, left + offset, piece, right, right_size,
+                  scratch + 2 * right_size);
+      } else {
+        Karatsuba(product, right, right_size, left + offset, piece,
+                  scratch + 2 * right_size);
+      }
+      AddLimbs(res + offset, res + offset, piece + right_size, product,
+               piece + right_size);
+    }
+    return;
   }
-  return ostream;
+  int left_high = left_size - half;
+  int right_high = right_size - half;
+  Limb* left_sum = scratch;
+  Limb* right_sum = left_sum + half + 1;
+  Limb* middle = right_sum + half + 1;
+  Limb* rest = middle + 2 * half + 2;
+  left_sum[half] = AddLimbs(left_sum, left, half, left + half, left_high);
+  right_sum[half] = AddLimbs(right_sum, right, half, right + half, right_high);
+  Karatsuba(middle, left_sum, half + 1, right_sum, half + 1, rest);
+  Karatsuba(res, left, half, right, half, rest);
+  Karatsuba(res + 2 * half, left + half, left_high, right + half, right_high,
+            rest);
+  SubLimbs(middle, middle, 2 * half + 2, res, 2 * half);
+  SubLimbs(middle, middle, 2 * half + 2, res + 2 * half,
+           left_high + right_high);
+  int total = left_size + right_size;
+  AddLimbs(res + half, res + half, total - half, middle,
+           std::min(2 * half + 2, total - half));
 }
 
-BigInt::BigInt(const BigInt& copy) {
-  biginteger_ = copy.biginteger_;
-  size_ = copy.size_;
-  is_negative_ = copy.is_negative_;
+// res[0, 2 * size) = big * big.
+void KaratsubaSquare(Limb* res, const Limb* big, int size, Limb* scratch) {
+  if (size < KaratsubaThreshold()) {
+    SqrLimbs(res, big, size);
+    return;
+  }
+  int half = (size + 1) / 2;
+  int high = size - half;
+  Limb* sum = scratch;
+  Limb* middle = sum + 2 * half + 2;
+  Limb* rest = middle + 2 * half + 2;
+  sum[half] = AddLimbs(sum, big, half, big + half, high);
+  KaratsubaSquare(middle, sum, half + 1, rest);
+  KaratsubaSquare(res, big, half, rest);
+  KaratsubaSquare(res + 2 * half, big + half, high, rest);
+  SubLimbs(middle, middle, 2 * half + 2, res, 2 * half);
+  SubLimbs(middle, middle, 2 * half + 2, res + 2 * half, 2 * high);
+  AddLimbs(res + half, res + half, 2 * size - half, middle,
+           std::min(2 * half + 2, 2 * size - half));
 }
 
-BigInt& BigInt::operator=(const BigInt& copy) {
-  if (this == &copy) {
-    return *this;
+// big = big * multiplier + addend, returns the carry out.
+Limb MulSmallLimbs(Limb* big, int size, Limb multiplier, Limb addend) {
+  Limb carry = addend;
+  for (int i = 0; i < size; ++i) {
+    DoubleLimb cur = static_cast<DoubleLimb>(big[i]) * multiplier + carry;
+    big[i] = static_cast<Limb>(cur);
+    carry = static_cast<Limb>(cur >> 64);
   }
-  biginteger_ = copy.biginteger_;
-  is_negative_ = copy.is_negative_;
-  size_ = copy.size_;
-  return *this;
+  return carry;
 }
 
-bool BigInt::operator==(const BigInt& big) const {
-  if (size_ == 0 && big.size_ == 0) {
-    return true;
-  }
-  if (size_ != big.size_) {
-    return false;
+#if defined(__x86_64__) || defined(__i386__)
+
+// Vector types of Bytes wide lanes and the Bytes / 2 of 32-bit words that
+// widen into them. Spelled out per width, g++ rejects __builtin_convertvector
+// on vector types whose size depends on a template parameter.
+template <int Bytes>
+struct HalvesVectors;
+
+#define BIG_INTEGER_HALVES_VECTORS(bytes)                                  \
+  template <>                                                               \
+  struct HalvesVectors<bytes> {                                             \
+    typedef uint64_t Wide __attribute__((vector_size(bytes)));              \
+    typedef uint32_t Narrow __attribute__((vector_size(bytes / 2)));        \
+    typedef Wide WideRef __attribute__((aligned(sizeof(Limb)), may_alias)); \
+    typedef Narrow NarrowRef                                                \
+        __attribute__((aligned(sizeof(uint32_t)), may_alias));              \
+  };
+BIG_INTEGER_HALVES_VECTORS(16)
+BIG_INTEGER_HALVES_VECTORS(32)
+BIG_INTEGER_HALVES_VECTORS(64)
+#undef BIG_INTEGER_HALVES_VECTORS
+
+// lanes[0, 2 * size) += the 32-bit halves of big[0, size), no carries. On x86
+// the halves are consecutive little-endian 32-bit words, so each vector step
+// widens Bytes / 8 of them and adds them to as many lanes.
+template <int Bytes>
+inline __attribute__((always_inline)) void AddHalvesLoop(
+    Limb* __restrict lanes, const Limb* __restrict big, int size) {
+  typedef HalvesVectors<Bytes> Vectors;
+  const int kStep = Bytes / sizeof(Limb);
+  const int count = 2 * size;
+  int i = 0;
+  for (; i + kStep <= count; i += kStep) {
+    typename Vectors::Narrow words =
+        *reinterpret_cast<const typename Vectors::NarrowRef*>(big + i / 2);
+    *reinterpret_cast<typename Vectors::WideRef*>(lanes + i) +=
+        __builtin_convertvector(words, typename Vectors::Wide);
   }
-  if (is_negative_ != big.is_negative_) {
-    return false;
+  for (; i < count; i += 2) {
+    lanes[i] += static_cast<uint32_t>(big[i / 2]);
+    lanes[i + 1] += big[i / 2] >> 32;
   }
-  for (int i = 0; i < size_; ++i) {
-    if (biginteger_[i] != big.biginteger_[i]) {
-      return false;
+}
+
+// Instruction sets AddHalves is built for, the best one the running CPU
+// supports is picked once at the first call.
+enum class SimdLevel { kDefault, kAvx2, kAvx512 };
+
+SimdLevel DetectSimdLevel() {
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return SimdLevel::kAvx512;
+    }
+    return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2
+                                          : SimdLevel::kDefault;
+  }();
+  return level;
+}
+
+__attribute__((target("avx512f"))) void AddHalvesAvx512(
+    Limb* __restrict lanes, const Limb* __restrict big, int size) {
+  AddHalvesLoop<64>(lanes, big, size);
+}
+
+__attribute__((target("avx2"))) void AddHalvesAvx2(
+    Limb* __restrict lanes, const Limb* __restrict big, int size) {
+  AddHalvesLoop<32>(lanes, big, size);
+}
+
+// Limb counts below which AddHalves stays on the inline SSE2 loop.
+const int kHalvesSmall = 16;
+
+void AddHalves(Limb* __restrict lanes, const Limb* __restrict big, int size) {
+  if (size >= kHalvesSmall) {
+    switch (DetectSimdLevel()) {
+      case SimdLevel::kAvx512:
+        AddHalvesAvx512(lanes, big, size);
+        return;
+      case SimdLevel::kAvx2:
+        AddHalvesAvx2(lanes, big, size);
+        return;
+      case SimdLevel::kDefault:
+        break;
     }
   }
-  return true;
+  AddHalvesLoop<16>(lanes, big, size);
 }
 
-BigInt Abs(const BigInt& big) {
-  BigInt bigabs = big;
-  bigabs.Negative() = false;
-  return bigabs;
+#else
+
+// lanes[0, 2 * size) += the 32-bit halves of big[0, size), no carries.
+void AddHalves(Limb* __restrict lanes, const Limb* __restrict big, int size) {
+  for (int i = 0; i < size; ++i) {
+    lanes[2 * i] += static_cast<uint32_t>(big[i]);
+    lanes[2 * i + 1] += big[i] >> 32;
+  }
 }
 
-bool BigInt::operator<(const BigInt& big) const {
-  if (size_ == 0 || big.size_ == 0) {
-    return BigInt::Zerobool(*this, big);
+#endif
+
+// res[0, size) += big * multiplier, returns the carry out.
+Limb AddMulLimbs(Limb* res, const Limb* big, int size, Limb multiplier) {
+  Limb carry = 0;
+  for (int i = 0; i < size; ++i) {
+    DoubleLimb cur =
+        static_cast<DoubleLimb>(big[i]) * multiplier + res[i] + carry;
+    res[i] = static_cast<Limb>(cur);
+    carry = static_cast<Limb>(cur >> 64);
   }
-  if (*this == big) {
-    return false;
+  return carry;
+}
+
+// floor((B^2 - 1) / divisor) - B for a normalized divisor (top bit set).
+Limb ReciprocalLimb(Limb divisor) {
+  DoubleLimb numerator = (static_cast<DoubleLimb>(~divisor) << 64) | ~Limb{0};
+  return static_cast<Limb>(numerator / divisor);
+}
+
+// Divides the two-limb value (high, low) by a normalized divisor using its
+// precomputed reciprocal (Moller-Granlund), requires high < divisor.
+Limb DivTwoByOne(Limb high, Limb low, Limb divisor, Limb reciprocal,
+                 Limb& rem) {
+  DoubleLimb quot = static_cast<DoubleLimb>(reciprocal) * high;
+  quot += (static_cast<DoubleLimb>(high) << 64) | low;
+  Limb quot_high = static_cast<Limb>(quot >> 64) + 1;
+  Limb quot_low = static_cast<Limb>(quot);
+  Limb cur = low - quot_high * divisor;
+  if (cur > quot_low) {
+    --quot_high;
+    cur += divisor;
   }
-  if (is_negative_ != big.is_negative_) {
-    return is_negative_;
+  if (cur >= divisor) {
+    ++quot_high;
+    cur -= divisor;
   }
-  if (size_ < big.size_) {
-    return true;
+  rem = cur;
+  return quot_high;
+}
+
+// big = big / divisor, returns the remainder.
+Limb DivSmallLimbs(Limb* big, int size, Limb divisor) {
+  int shift = __builtin_clzll(divisor);
+  Limb normalized = divisor << shift;
+  Limb reciprocal = ReciprocalLimb(normalized);
+  Limb rem = 0;
+  if (shift == 0) {
+    for (int i = size - 1; i >= 0; --i) {
+      big[i] = DivTwoByOne(rem, big[i], normalized, reciprocal, rem);
+    }
+    return rem;
   }
-  if (size_ > big.size_) {
-    return false;
+  if (size > 0) {
+    rem = big[size - 1] >> (64 - shift);
   }
-  if (!is_negative_) {
-    for (int i = big.Size() - 1; i >= 0; --i) {
-      if (biginteger_[i] != big.biginteger_[i]) {
-        return (biginteger_[i] < big.biginteger_[i]);
-      }
+  for (int i = size - 1; i >= 0; --i) {
+    Limb low = big[i] << shift;
+    if (i > 0) {
+      low |= big[i - 1] >> (64 - shift);
     }
-    return true;
+    big[i] = DivTwoByOne(rem, low, normalized, reciprocal, rem);
   }
-  for (int i = Size() - 1; i >= 0; --i) {
-    if (biginteger_[i] != big.biginteger_[i]) {
-      return (biginteger_[i] > big.biginteger_[i]);
+  return rem >> shift;
+}
+
+// Knuth's Algorithm D: quot[0, num_size - den_size + 1) and rem[0, den_size)
+// receive num / den and num % den. Requires den_size >= 2, a nonzero top limb
+// in den and num_size >= den_size.
+void DivLimbs(Limb* quot, Limb* rem, const Limb* num, int num_size,
+              const Limb* den, int den_size) {
+  int shift = __builtin_clzll(den[den_size - 1]);
+  BigInt::Limbs norm_den;
+  BigInt::Limbs norm_num;
+  norm_den.resize(den_size);
+  norm_num.resize(num_size + 1);
+  ShiftLeftLimbs(norm_den.data(), den, den_size, shift);
+  norm_num[num_size] = ShiftLeftLimbs(norm_num.data(), num, num_size, shift);
+  Limb top = norm_den[den_size - 1];
+  Limb next = norm_den[den_size - 2];
+  Limb reciprocal = ReciprocalLimb(top);
+  for (int j = num_size - den_size; j >= 0; --j) {
+    Limb* window = norm_num.data() + j;
+    Limb quot_hat;
+    Limb rem_hat;
+    bool rem_overflow = false;
+    if (window[den_size] >= top) {
+      // The estimate saturates at B - 1,
+      // rem_hat = num_hi * B + num_lo - q * top.
+      quot_hat = ~Limb{0};
+      rem_hat = window[den_size - 1] + top;
+      rem_overflow = rem_hat < top;
+    } else {
+      quot_hat = DivTwoByOne(window[den_size], window[den_size - 1], top,
+                             reciprocal, rem_hat);
+    }
+    while (!rem_overflow &&
+           static_cast<DoubleLimb>(quot_hat) * next >
+               ((static_cast<DoubleLimb>(rem_hat) << 64) |
+                window[den_size - 2])) {
+      --quot_hat;
+      rem_hat += top;
+      rem_overflow = rem_hat < top;
     }
+    Limb carry = 0;
+    Limb borrow = 0;
+    for (int i = 0; i < den_size; ++i) {
+      DoubleLimb product = static_cast<DoubleLimb>(quot_hat) * norm_den[i] +
+                           carry;
+      carry = static_cast<Limb>(product >> 64);
+      Limb sub = static_cast<Limb>(product);
+      Limb diff = window[i] - sub;
+      Limb next_borrow = static_cast<Limb>(window[i] < sub);
+      next_borrow += static_cast<Limb>(diff < borrow);
+      window[i] = diff - borrow;
+      borrow = next_borrow;
+    }
+    Limb high = window[den_size];
+    window[den_size] = high - carry - borrow;
+    if (high < carry || high - carry < borrow) {
+      --quot_hat;
+      window[den_size] += AddLimbs(window, window, den_size, norm_den.data(),
+                                   den_size);
+    }
+    quot[j] = quot_hat;
   }
-  return false;
+  ShiftRightLimbs(rem, norm_num.data(), den_size, shift);
 }
 
-bool BigInt::Zerobool(const BigInt& left, const BigInt& right) {
-  if ((left.Size() == 0) && (right.Size() == 0)) {
-    return false;
+// Montgomery reduction (REDC): value[0, 2 * size + 1) holds a number below
+// modulus * B^size, res[0, size) receives value / B^size mod modulus.
+// inverse is -modulus^-1 mod B. Clobbers value.
+void MontgomeryReduce(Limb* value, const Limb* modulus, int size,
+                      Limb inverse, Limb* res) {
+  for (int i = 0; i < size; ++i) {
+    Limb carry = AddMulLimbs(value + i, modulus, size, value[i] * inverse);
+    for (Limb* cur = value + i + size; carry != 0; ++cur) {
+      *cur += carry;
+      carry = static_cast<Limb>(*cur < carry);
+    }
   }
-  if ((left.Size() == 0) && (right.Negative()) && (right.Size() != 0)) {
-    return false;
+  if (value[2 * size] != 0 ||
+      CompareLimbs(value + size, size, modulus, size) >= 0) {
+    SubLimbs(res, value + size, size, modulus, size);
+  } else {
+    std::copy(value + size, value + 2 * size, res);
   }
-  if ((left.Size() == 0) && !(right.Negative()) && (right.Size() != 0)) {
-    return true;
+}
+
+// Sliding window width for an exponent of the given bit length.
+int WindowBits(int64_t bits) {
+  if (bits > 671) {
+    return 6;
   }
-  if ((right.Size() == 0) && (left.Negative()) && (left.Size() != 0)) {
-    return true;
+  if (bits > 239) {
+    return 5;
   }
-  if ((right.Size() == 0) && !(left.Negative()) && (left.Size() != 0)) {
-    return false;
+  if (bits > 79) {
+    return 4;
   }
-  return false;
+  return bits > 23 ? 3 : 1;
 }
 
-bool BigInt::operator<=(const BigInt& big) const { return !(*this > big); }
-
-bool BigInt::operator>(const BigInt& big) const {
-  return !(*this < big || *this == big);
+// Lehmer's inner loop on the leading bits x >= y, x < 2^61, of two operands.
+// Returns the number of Euclidean steps that are certain to match those of
+// the full operands (Jebelean's condition) and their cofactors in matrix:
+// the steps map (a, b) to (a * A - b * B, b * D - a * C) for matrix = {A, B,
+// C, D}, with a and b exchanged first when the count is odd. The cofactors
+// stay below 2^31.
+int LehmerMatrix(Limb x, Limb y, Limb* matrix) {
+  Limb a = 1;
+  Limb b = 0;
+  Limb c = 0;
+  Limb d = 1;
+  int steps = 0;
+  while (y != c) {
+    // Quotients are 1 about 40% of the time, and dividing is much slower.
+    Limb num = x + (a - 1);
+    Limb den = y - c;
+    Limb quot = num - den < den ? 1 : num / den;
+    Limb product = quot * y;
+    if (product > x) {
+      break;
+    }
+    Limb next_c = b + quot * d;
+    Limb rem = x - product;
+    if (next_c > rem) {
+      break;
+    }
+    Limb next_d = a + quot * c;
+    x = y;
+    y = rem;
+    a = d;
+    b = c;
+    c = next_c;
+    d = next_d;
+    ++steps;
+  }
+  matrix[0] = a;
+  matrix[1] = b;
+  matrix[2] = c;
+  matrix[3] = d;
+  return steps;
 }
 
-bool BigInt::operator>=(const BigInt& big) const {
-  return !(*this > big || *this == big);
+// Euclid's algorithm on the words x >= y, leaving their GCD in x. Returns
+// the number of steps and sets matrix as LehmerMatrix does, without bounds on
+// the cofactors other than x / gcd.
+int EuclidMatrix(Limb& x, Limb y, Limb* matrix) {
+  Limb a = 1;
+  Limb b = 0;
+  Limb c = 0;
+  Limb d = 1;
+  int steps = 0;
+  while (y != 0) {
+    Limb quot = x / y;
+    Limb rem = x - quot * y;
+    Limb next_c = b + quot * d;
+    Limb next_d = a + quot * c;
+    x = y;
+    y = rem;
+    a = d;
+    b = c;
+    c = next_c;
+    d = next_d;
+    ++steps;
+  }
+  matrix[0] = a;
+  matrix[1] = b;
+  matrix[2] = c;
+  matrix[3] = d;
+  return steps;
 }
 
-bool BigInt::operator!=(const BigInt& big) const { return !(*this == big); }
+// (left, right) = (left * A - right * B, right * D - left * C) in place for
+// matrix = {A, B, C, D} from LehmerMatrix, both results are non-negative.
+void LehmerUpdate(Limb* left, Limb* right, int size, const Limb* matrix) {
+  // The partial sums stay within 2^96 in magnitude, so they are computed
+  // modulo 2^128 and only the carries are read as signed.
+  using SignedDoubleLimb = __int128;
+  DoubleLimb left_carry = 0;
+  DoubleLimb right_carry = 0;
+  for (int i = 0; i < size; ++i) {
+    DoubleLimb left_cur = static_cast<DoubleLimb>(left[i]) * matrix[0] -
+                          static_cast<DoubleLimb>(right[i]) * matrix[1] +
+                          left_carry;
+    DoubleLimb right_cur = static_cast<DoubleLimb>(right[i]) * matrix[3] -
+                           static_cast<DoubleLimb>(left[i]) * matrix[2] +
+                           right_carry;
+    left[i] = static_cast<Limb>(left_cur);
+    right[i] = static_cast<Limb>(right_cur);
+    left_carry = static_cast<DoubleLimb>(
+        static_cast<SignedDoubleLimb>(left_cur) >> 64);
+    right_carry = static_cast<DoubleLimb>(
+        static_cast<SignedDoubleLimb>(right_cur) >> 64);
+  }
+}
 
-std::istream& operator>>(std::istream& istream, BigInt& big) {
-  std::string strint;
-  istream >> strint;
-  big = strint;
-  return istream;
+// (left, right) = (left * A + right * B, right * D + left * C) in place:
+// LehmerUpdate for the cofactors, whose signs alternate, so their magnitudes
+// add. The top limb of both must be zero on entry.
+void LehmerCofactors(Limb* left, Limb* right, int size, const Limb* matrix) {
+  Limb left_carry = 0;
+  Limb right_carry = 0;
+  for (int i = 0; i < size; ++i) {
+    DoubleLimb left_cur = static_cast<DoubleLimb>(left[i]) * matrix[0] +
+                          static_cast<DoubleLimb>(right[i]) * matrix[1] +
+                          left_carry;
+    DoubleLimb right_cur = static_cast<DoubleLimb>(right[i]) * matrix[3] +
+                           static_cast<DoubleLimb>(left[i]) * matrix[2] +
+                           right_carry;
+    left[i] = static_cast<Limb>(left_cur);
+    right[i] = static_cast<Limb>(right_cur);
+    left_carry = static_cast<Limb>(left_cur >> 64);
+    right_carry = static_cast<Limb>(right_cur >> 64);
+  }
 }
 
-BigInt& BigInt::operator+=(const BigInt& big) {
-  BigInt bigcopy = big;
-  if (is_negative_ == big.is_negative_) {
-    if (this->Size() < big.Size()) {
-      this->Swap(bigcopy);
-    }
-    biginteger_.push_back(0);
-    for (int i = 0; i < (this->Size() - bigcopy.Size() + 1); ++i) {
-      bigcopy.Data().push_back(0);
-    }
-    for (int i = 0; i < this->Size(); ++i) {
-      biginteger_[i + 1] +=
-          (biginteger_[i] + bigcopy.biginteger_[i]) / kSystcomp;
-      biginteger_[i] = (biginteger_[i] + bigcopy.biginteger_[i]) % kSystcomp;
-    }
-    if (biginteger_[Size()] == 0) {
-      biginteger_.pop_back();
-    } else {
-      ++size_;
+// Binary GCD of two words.
+Limb GcdLimb(Limb left, Limb right) {
+  if (left == 0 || right == 0) {
+    return left | right;
+  }
+  int shift = __builtin_ctzll(left | right);
+  left >>= __builtin_ctzll(left);
+  while (right != 0) {
+    right >>= __builtin_ctzll(right);
+    if (left > right) {
+      std::swap(left, right);
     }
-    return *this;
+    right -= left;
   }
-  *this = MinusPart(*this, bigcopy);
-  return *this;
+  return left << shift;
 }
 
-BigInt BigInt::MinusPart(BigInt left, BigInt bigcopy) const {
-  if (Abs(left) < Abs(bigcopy)) {
-    left.Swap(bigcopy);
+// Floor of the square root of a word.
+Limb IsqrtLimb(Limb value) {
+  Limb root = static_cast<Limb>(std::sqrt(static_cast<double>(value)));
+  while (static_cast<DoubleLimb>(root) * root > value) {
+    --root;
   }
-  for (int i = 0; i < (left.Size() - bigcopy.Size()); ++i) {
-    bigcopy.Data().push_back(0);
+  while (static_cast<DoubleLimb>(root + 1) * (root + 1) <= value) {
+    ++root;
   }
-  for (int i = 0; i < left.Size(); ++i) {
-    if (left.biginteger_[i] < bigcopy.biginteger_[i]) {
-      --left.biginteger_[i + 1];
-      left.biginteger_[i] += kSystcomp;
-    }
-    left.biginteger_[i] -= bigcopy.biginteger_[i];
+  return root;
+}
+
+// Whether base^degree <= bound, without overflow.
+bool PowAtMost(Limb base, int degree, Limb bound) {
+  if (base <= 1) {
+    return base <= bound;
   }
-  for (int i = left.Size() - 1; i >= 0; --i) {
-    if (left.biginteger_[i] == 0) {
-      --left.size_;
-    } else {
-      break;
+  DoubleLimb power = 1;
+  for (int i = 0; i < degree; ++i) {
+    power *= base;
+    if (power > bound) {
+      return false;
     }
   }
-  return left;
+  return true;
 }
 
-BigInt& BigInt::operator-=(const BigInt& big) {
-  *this += -big;
-  return *this;
+// Floor of the degree-th root of a word.
+Limb IRootLimb(Limb value, int degree) {
+  Limb root = static_cast<Limb>(
+      std::pow(static_cast<double>(value), 1.0 / degree));
+  while (root > 0 && !PowAtMost(root, degree, value)) {
+    --root;
+  }
+  while (PowAtMost(root + 1, degree, value)) {
+    ++root;
+  }
+  return root;
 }
 
-BigInt& BigInt::operator*=(const BigInt& big) {
-  BigInt multiply = 0;
-  multiply.is_negative_ = false;
-  multiply.size_ = size_ + big.size_;
-  for (int i = 0; i < multiply.size_ + 2; ++i) {
-    multiply.biginteger_.push_back(0);
+// Set on pool workers and on a thread running a parallel product, so that
+// the sub-products stay serial.
+thread_local bool serial_multiply = false;
+
+// Worker threads running batches of independent tasks, started as Run asks
+// for them and never stopped before the pool is destroyed. The thread
+// calling Run works on the batch as well, and a second caller that finds the
+// pool busy runs its batch alone.
+class ThreadPool {
+ public:
+  ~ThreadPool();
+  // Runs tasks on at most threads threads, the calling one included, and
+  // returns once all have finished, rethrowing the first exception.
+  void Run(std::vector<std::function<void()>>& tasks, int threads);
+
+ private:
+  struct Batch {
+    std::vector<std::function<void()>>* tasks = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> pending{0};
+    // Workers that may still join, so that idle extra workers stay out.
+    std::atomic<int> helpers{0};
+    std::exception_ptr error;
+  };
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::mutex run_mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::shared_ptr<Batch> batch_;
+  bool stop_ = false;
+  void Loop();
+  void Work(Batch& batch);
+};
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
   }
-  for (int i = 0; i < size_; ++i) {
-    for (int j = 0; j < big.size_; ++j) {
-      multiply.biginteger_[i + j] +=
-          (biginteger_[i] * big.biginteger_[j]) % kSystcomp;
-      multiply.biginteger_[i + j + 1] +=
-          (biginteger_[i] * big.biginteger_[j]) / kSystcomp;
-      if (multiply.biginteger_[i + j] >= kSystcomp) {
-        multiply.biginteger_[i + j + 1] +=
-            multiply.biginteger_[i + j] / kSystcomp;
-        multiply.biginteger_[i + j] = multiply.biginteger_[i + j] % kSystcomp;
+  wake_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Run(std::vector<std::function<void()>>& tasks,
+                     int threads) {
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+  if (!run_lock.owns_lock() || threads <= 1) {
+    for (std::function<void()>& task : tasks) {
+      task();
+    }
+    return;
+  }
+  auto batch = std::make_shared<Batch>();
+  batch->tasks = &tasks;
+  batch->count = tasks.size();
+  batch->pending = tasks.size();
+  batch->helpers = threads - 1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (static_cast<int>(workers_.size()) < threads - 1) {
+      workers_.emplace_back([this] { Loop(); });
+    }
+    batch_ = batch;
+  }
+  wake_.notify_all();
+  Work(*batch);
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [&batch] { return batch->pending == 0; });
+  batch_ = nullptr;
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+void ThreadPool::Loop() {
+  serial_multiply = true;
+  std::shared_ptr<Batch> seen;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this, &seen] {
+        return stop_ || (batch_ != nullptr && batch_ != seen);
+      });
+      if (stop_) {
+        return;
       }
-      if (multiply.biginteger_[i + j + 1] >= kSystcomp) {
-        multiply.biginteger_[i + j + 2] +=
-            multiply.biginteger_[i + j + 1] / kSystcomp;
-        multiply.biginteger_[i + j + 1] =
-            multiply.biginteger_[i + j + 1] % kSystcomp;
+      seen = batch_;
+    }
+    if (seen->helpers-- > 0) {
+      Work(*seen);
+    }
+  }
+}
+
+void ThreadPool::Work(Batch& batch) {
+  for (size_t i = batch.next++; i < batch.count; i = batch.next++) {
+    try {
+      (*batch.tasks)[i]();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!batch.error) {
+        batch.error = std::current_exception();
       }
     }
+    if (--batch.pending == 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.notify_all();
+    }
   }
-  *this = Multiply(multiply, big);
-  return *this;
 }
 
-BigInt BigInt::Multiply(BigInt multiply, const BigInt& big) const {
-  for (int i = multiply.size_ - 1; i >= 0; --i) {
-    if (multiply.biginteger_[i] == 0) {
-      --multiply.size_;
-    } else {
-      break;
+// The pool shared by all multiplications. It only grows, so changing the
+// thread count never tears down workers a running product is using.
+ThreadPool& Pool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+// Runs the tasks of one product on the pool with serial_multiply set, so
+// that their sub-products stay serial, and clears it even if a task throws.
+void RunProducts(std::vector<std::function<void()>>& tasks, int threads) {
+  serial_multiply = true;
+  try {
+    Pool().Run(tasks, threads);
+  } catch (...) {
+    serial_multiply = false;
+    throw;
+  }
+  serial_multiply = false;
+}
+
+// Transforms modulo a prime p = c * 2^k + 1 below 2^62. Arithmetic is in
+// Montgomery form, so Mul(a, b) is a * b / 2^64 mod p. Twiddles are stored
+// premultiplied by 2^64, which makes multiplying by them exact.
+class Ntt {
+ public:
+  Ntt(Limb modulus, Limb generator, int log_size);
+  Limb Mul(Limb left, Limb right) const;
+  // Montgomery form of value, value < 2^64.
+  Limb ToMontgomery(Limb value) const;
+  // base^exponent for base in Montgomery form.
+  Limb Pow(Limb base, Limb exponent) const;
+  // Decimation in frequency, bit-reversed output.
+  void Forward(Limb* values) const;
+  // Decimation in time from bit-reversed input, without the 1 / size scale.
+  void Inverse(Limb* values) const;
+  // res[i] = left[i] * right[i] / size, undoing Forward and Inverse.
+  void Pointwise(Limb* res, const Limb* left, const Limb* right) const;
+
+ private:
+  Limb modulus_;
+  Limb inverse_;
+  Limb scale_;
+  size_t size_;
+  BigInt::Limbs roots_;
+  BigInt::Limbs inverse_roots_;
+  Limb Add(Limb left, Limb right) const;
+  Limb Sub(Limb left, Limb right) const;
+};
+
+Ntt::Ntt(Limb modulus, Limb generator, int log_size)
+    : modulus_(modulus), size_(size_t{1} << log_size) {
+  Limb inverse = modulus;
+  for (int i = 0; i < 5; ++i) {
+    inverse *= 2 - modulus * inverse;
+  }
+  inverse_ = 0 - inverse;
+  // Mul(x, 2^128 / size) = x * 2^64 / size, and Mul of that by the
+  // Montgomery product restores a plain value.
+  Limb r_squared = static_cast<Limb>(
+      static_cast<DoubleLimb>(ToMontgomery(1)) * ToMontgomery(1) % modulus);
+  Limb size_inverse = modulus - (modulus - 1) / size_;
+  scale_ = static_cast<Limb>(static_cast<DoubleLimb>(r_squared) *
+                             size_inverse % modulus);
+  roots_.resize(size_);
+  inverse_roots_.resize(size_);
+  if (size_ == 1) {
+    return;
+  }
+  Limb root = Pow(ToMontgomery(generator), (modulus - 1) / size_);
+  Limb inverse_root = Pow(root, size_ - 1);
+  size_t half = size_ / 2;
+  roots_[half] = ToMontgomery(1);
+  inverse_roots_[half] = ToMontgomery(1);
+  for (size_t i = 1; i < half; ++i) {
+    roots_[half + i] = Mul(roots_[half + i - 1], root);
+    inverse_roots_[half + i] = Mul(inverse_roots_[half + i - 1], inverse_root);
+  }
+  for (size_t len = half / 2; len >= 1; len /= 2) {
+    for (size_t i = 0; i < len; ++i) {
+      roots_[len + i] = roots_[2 * len + 2 * i];
+      inverse_roots_[len + i] = inverse_roots_[2 * len + 2 * i];
     }
   }
-  multiply.is_negative_ = is_negative_ != big.is_negative_;
-  return multiply;
 }
 
-BigInt operator*(const BigInt& lvalue, const BigInt& rvalue) {
-  BigInt multiply = lvalue;
-  multiply *= rvalue;
-  return multiply;
+Limb Ntt::Mul(Limb left, Limb right) const {
+  DoubleLimb product = static_cast<DoubleLimb>(left) * right;
+  Limb factor = static_cast<Limb>(product) * inverse_;
+  Limb res = static_cast<Limb>(
+      (product + static_cast<DoubleLimb>(factor) * modulus_) >> 64);
+  return res >= modulus_ ? res - modulus_ : res;
 }
 
-BigInt operator+(const BigInt& lvalue, const BigInt& rvalue) {
-  BigInt multiply = lvalue;
-  multiply += rvalue;
-  return multiply;
+Limb Ntt::ToMontgomery(Limb value) const {
+  return static_cast<Limb>((static_cast<DoubleLimb>(value) << 64) % modulus_);
 }
 
-BigInt operator/(const BigInt& lvalue, const BigInt& rvalue) {
-  BigInt multiply = lvalue;
-  multiply /= rvalue;
-  return multiply;
+Limb Ntt::Add(Limb left, Limb right) const {
+  Limb res = left + right;
+  return res >= modulus_ ? res - modulus_ : res;
 }
 
-BigInt operator-(const BigInt& lvalue, const BigInt& rvalue) {
-  BigInt multiply = lvalue;
-  multiply -= rvalue;
-  return multiply;
+Limb Ntt::Sub(Limb left, Limb right) const {
+  return left >= right ? left - right : left + modulus_ - right;
 }
 
-BigInt operator%(const BigInt& lvalue, const BigInt& rvalue) {
-  BigInt multiply = lvalue;
-  multiply %= rvalue;
-  return multiply;
+Limb Ntt::Pow(Limb base, Limb exponent) const {
+  Limb res = ToMontgomery(1);
+  for (; exponent != 0; exponent >>= 1) {
+    if ((exponent & 1) != 0) {
+      res = Mul(res, base);
+    }
+    base = Mul(base, base);
+  }
+  return res;
 }
 
-void BigInt::DivisionByTwo() {
-  for (int i = Size() - 1; i > 0; --i) {
-    int time = biginteger_[i];
-    biginteger_[i] /= 2;
-    if ((time % 2) == 1) {
-      biginteger_[i - 1] += kSystcomp;
+void Ntt::Forward(Limb* values) const {
+  for (size_t len = size_ / 2; len >= 1; len /= 2) {
+    for (size_t start = 0; start < size_; start += 2 * len) {
+      Limb* low = values + start;
+      Limb* high = low + len;
+      for (size_t i = 0; i < len; ++i) {
+        Limb sum = Add(low[i], high[i]);
+        high[i] = Mul(Sub(low[i], high[i]), roots_[len + i]);
+        low[i] = sum;
+      }
     }
   }
-  biginteger_[0] = biginteger_[0] / 2;
 }
 
-BigInt& BigInt::operator++() {
-  *this += 1;
-  return *this;
+void Ntt::Inverse(Limb* values) const {
+  for (size_t len = 1; len < size_; len *= 2) {
+    for (size_t start = 0; start < size_; start += 2 * len) {
+      Limb* low = values + start;
+      Limb* high = low + len;
+      for (size_t i = 0; i < len; ++i) {
+        Limb twisted = Mul(high[i], inverse_roots_[len + i]);
+        high[i] = Sub(low[i], twisted);
+        low[i] = Add(low[i], twisted);
+      }
+    }
+  }
 }
 
-BigInt& BigInt::operator--() {
-  *this -= 1;
-  return *this;
+void Ntt::Pointwise(Limb* res, const Limb* left, const Limb* right) const {
+  for (size_t i = 0; i < size_; ++i) {
+    res[i] = Mul(Mul(left[i], right[i]), scale_);
+  }
 }
 
-BigInt BigInt::operator--(int) {
-  BigInt old = *this;
-  operator--();
-  return old;
+// Three primes c * 2^k + 1 with their generators. Their product is about
+// 2^183.7, so a coefficient stays exact while it sums at most
+// (p0 * p1 * p2 - 1) / (2^64 - 1)^2, about 2^55.7, limb products, and the
+// smallest 2^k, 2^55, bounds the transform length.
+const Limb kNttPrimes[3] = {4179340454199820289ULL, 2485986994308513793ULL,
+                            1945555039024054273ULL};
+const Limb kNttGenerators[3] = {3, 5, 5};
+// Both limits rounded down to a power of two.
+const int kNttMaxLog = 55;
+
+// Whether NttMultiply is exact for these operand sizes.
+bool NttFits(int left_size, int right_size) {
+  uint64_t terms = std::min(left_size, right_size);
+  uint64_t points = static_cast<uint64_t>(left_size) + right_size - 1;
+  return terms <= (uint64_t{1} << kNttMaxLog) &&
+         points <= (uint64_t{1} << kNttMaxLog);
 }
 
-BigInt BigInt::operator++(int) {
-  BigInt old = *this;
-  operator++();
-  return old;
+// res[0, left_size + right_size) = left * right through three number
+// theoretic transforms on whole limbs and CRT recombination by Garner's
+// formula. With threads > 1 the three primes are transformed concurrently on
+// the pool. res must not alias inputs.
+void NttMultiply(Limb* res, const Limb* left, int left_size,
+                 const Limb* right, int right_size, int threads) {
+  bool square = left == right && left_size == right_size;
+  size_t size = static_cast<size_t>(left_size) + right_size;
+  int log_size = 0;
+  while ((size_t{1} << log_size) < size - 1) {
+    ++log_size;
+  }
+  size_t length = size_t{1} << log_size;
+  threads = std::min(threads, 3);
+  // Buffers are sized here, so that the tasks only write into them. The
+  // primes share one scratch for the right operand unless they run
+  // concurrently.
+  BigInt::Limbs residues[3];
+  BigInt::Limbs scratch[3];
+  for (int p = 0; p < 3; ++p) {
+    residues[p].resize(length);
+    if (!square && (p == 0 || threads > 1)) {
+      scratch[p].resize(length);
+    }
+  }
+  std::vector<std::function<void()>> transforms;
+  for (int p = 0; p < 3; ++p) {
+    transforms.push_back([&, p] {
+      Ntt ntt(kNttPrimes[p], kNttGenerators[p], log_size);
+      BigInt::Limbs& values = residues[p];
+      std::fill(values.begin(), values.end(), 0);
+      for (int i = 0; i < left_size; ++i) {
+        values[i] = left[i] % kNttPrimes[p];
+      }
+      ntt.Forward(values.data());
+      if (square) {
+        ntt.Pointwise(values.data(), values.data(), values.data());
+      } else {
+        BigInt::Limbs& other = scratch[threads > 1 ? p : 0];
+        std::fill(other.begin(), other.end(), 0);
+        for (int i = 0; i < right_size; ++i) {
+          other[i] = right[i] % kNttPrimes[p];
+        }
+        ntt.Forward(other.data());
+        ntt.Pointwise(values.data(), values.data(), other.data());
+      }
+      ntt.Inverse(values.data());
+    });
+  }
+  if (threads > 1) {
+    RunProducts(transforms, threads);
+  } else {
+    for (std::function<void()>& transform : transforms) {
+      transform();
+    }
+  }
+  // c = r0 + p0 * t1 + p0 * p1 * t2 with t1 < p1 and t2 < p2. Constants are
+  // in Montgomery form, so Mul by them is a plain modular product.
+  const Limb p0 = kNttPrimes[0];
+  const Limb p1 = kNttPrimes[1];
+  const Limb p2 = kNttPrimes[2];
+  Ntt ntt1(p1, kNttGenerators[1], 0);
+  Ntt ntt2(p2, kNttGenerators[2], 0);
+  DoubleLimb p01 = static_cast<DoubleLimb>(p0) * p1;
+  Limb inverse01 = ntt1.Pow(ntt1.ToMontgomery(p0), p1 - 2);
+  Limb inverse012 = ntt2.Pow(ntt2.ToMontgomery(static_cast<Limb>(p01 % p2)),
+                             p2 - 2);
+  Limb p0_mod2 = ntt2.ToMontgomery(p0);
+  Limb p01_low = static_cast<Limb>(p01);
+  Limb p01_high = static_cast<Limb>(p01 >> 64);
+  Limb carry0 = 0;
+  Limb carry1 = 0;
+  Limb carry2 = 0;
+  for (size_t i = 0; i < size; ++i) {
+    Limb r0 = 0;
+    Limb r1 = 0;
+    Limb r2 = 0;
+    if (i < length) {
+      r0 = residues[0][i];
+      r1 = residues[1][i];
+      r2 = residues[2][i];
+    }
+    Limb t1 = ntt1.Mul(r1 + p1 - (r0 >= p1 ? r0 - p1 : r0), inverse01);
+    Limb x01_mod2 = r0 % p2 + ntt2.Mul(t1, p0_mod2);
+    if (x01_mod2 >= p2) {
+      x01_mod2 -= p2;
+    }
+    Limb t2 = ntt2.Mul(r2 + p2 - x01_mod2, inverse012);
+    DoubleLimb x01 = static_cast<DoubleLimb>(p0) * t1 + r0;
+    DoubleLimb low = static_cast<DoubleLimb>(t2) * p01_low;
+    DoubleLimb high = static_cast<DoubleLimb>(t2) * p01_high;
+    DoubleLimb acc = static_cast<DoubleLimb>(static_cast<Limb>(low)) +
+                     static_cast<Limb>(x01) + carry0;
+    res[i] = static_cast<Limb>(acc);
+    acc = (acc >> 64) + static_cast<Limb>(low >> 64) +
+          static_cast<Limb>(high) + static_cast<Limb>(x01 >> 64) + carry1;
+    carry0 = static_cast<Limb>(acc);
+    acc = (acc >> 64) + static_cast<Limb>(high >> 64) + carry2;
+    carry1 = static_cast<Limb>(acc);
+    carry2 = static_cast<Limb>(acc >> 64);
+  }
 }
 
-BigInt BigInt::operator-() const {
-  BigInt minus = *this;
-  minus.is_negative_ = !minus.is_negative_;
-  return minus;
+// The innermost ArenaScope on this thread.
+thread_local BigInt::ArenaScope* current_scope = nullptr;
+
+// A radix packs digits digits into one limb cell of value base^digits. bits is
+// log2(base) for power-of-two bases, 0 otherwise.
+struct Radix {
+  int base;
+  int digits;
+  Limb cell;
+  int bits;
+};
+
+Radix MakeRadix(int base) {
+  Radix radix = {base, 0, 1, 0};
+  while (radix.cell <= ~Limb{0} / base) {
+    radix.cell *= base;
+    ++radix.digits;
+  }
+  if ((base & (base - 1)) == 0) {
+    radix.bits = __builtin_ctz(base);
+  }
+  return radix;
 }
 
-BigInt& BigInt::operator/=(const BigInt& big) {
-  if (Abs(*this) < Abs(big)) {
-    *this = 0;
-    return *this;
+// Returns 36 for characters that are not digits in any base.
+int DigitValue(char symbol) {
+  if (symbol >= '0' && symbol <= '9') {
+    return symbol - '0';
   }
-  BigInt right = 1;
-  BigInt left = 1;
-  BigInt middle = 1;
-  while ((Abs(big) * right) <= Abs(*this)) {
-    left = right;
-    right *= 2;
-  }
-  while (((Abs(big) * (left + 1)) < Abs(*this))) {
-    middle = (left + right);
-    middle.DivisionByTwo();
-    if ((Abs(big) * middle) <= Abs(*this)) {
-      left = middle;
-    } else {
-      right = middle;
+  if (symbol >= 'a' && symbol <= 'z') {
+    return symbol - 'a' + 10;
+  }
+  if (symbol >= 'A' && symbol <= 'Z') {
+    return symbol - 'A' + 10;
+  }
+  return 36;
+}
+
+char DigitChar(Limb digit) {
+  return static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+}
+
+// Writes cell as exactly width digits into out.
+void WriteCell(char* out, int width, Limb cell, int base) {
+  if (base == 10) {
+    for (int i = width - 1; i >= 0; --i) {
+      out[i] = static_cast<char>('0' + cell % 10);
+      cell /= 10;
     }
+    return;
   }
-  *this = BigInt::Check(big, left, *this);
-  return *this;
+  for (int i = width - 1; i >= 0; --i) {
+    out[i] = DigitChar(cell % base);
+    cell /= base;
+  }
+}
+
+int CellWidth(Limb cell, int base) {
+  int width = 1;
+  for (; cell >= static_cast<Limb>(base); cell /= base) {
+    ++width;
+  }
+  return width;
 }
 
-BigInt BigInt::Check(BigInt big, BigInt left, BigInt ans) {
-  if (((Abs(big) * (left + 1)) <= Abs(ans))) {
-    ++left;
+// Writes limbs[0, size) with repeated division by the radix cell. A
+// non-negative width left-pads the output with zeros to exactly width digits.
+// Clobbers limbs and returns the end of the output.
+char* WriteBasecase(Limb* limbs, int size, const Radix& radix, int64_t width,
+                    char* out) {
+  BigInt::Limbs cells;
+  while (size > 0) {
+    cells.push_back(DivSmallLimbs(limbs, size, radix.cell));
+    while (size > 0 && limbs[size - 1] == 0) {
+      --size;
+    }
   }
-  if (ans.Negative() != big.Negative()) {
-    left.Negative() = true;
+  int count = static_cast<int>(cells.size());
+  if (width >= 0) {
+    char* end = out + width;
+    char* cur = end;
+    for (int i = 0; i < count; ++i) {
+      cur -= radix.digits;
+      WriteCell(cur, radix.digits, cells[i], radix.base);
+    }
+    std::fill(out, cur, '0');
+    return end;
   }
-  if (left.Data()[left.Size() - 1] == 0) {
-    --left.Size();
+  if (count == 0) {
+    *out = '0';
+    return out + 1;
   }
-  return left;
+  int top = CellWidth(cells[count - 1], radix.base);
+  WriteCell(out, top, cells[count - 1], radix.base);
+  out += top;
+  for (int i = count - 2; i >= 0; --i) {
+    WriteCell(out, radix.digits, cells[i], radix.base);
+    out += radix.digits;
+  }
+  return out;
 }
 
-BigInt& BigInt::operator%=(const BigInt& big) {
-  *this = (*this - (*this / big) * big);
-  for (int i = size_ - 1; i >= 0; --i) {
-    if (biginteger_[i] == 0) {
-      --size_;
-    } else {
-      break;
+char* WritePowerOfTwo(const Limb* limbs, int size, int bits, char* out) {
+  int64_t total = 64 * static_cast<int64_t>(size) -
+                  __builtin_clzll(limbs[size - 1]);
+  Limb mask = (Limb{1} << bits) - 1;
+  for (int64_t bit = (total - 1) / bits * bits; bit >= 0; bit -= bits) {
+    int64_t limb = bit / 64;
+    int offset = static_cast<int>(bit % 64);
+    Limb digit = limbs[limb] >> offset;
+    if (offset + bits > 64 && limb + 1 < size) {
+      digit |= limbs[limb + 1] << (64 - offset);
     }
+    *out++ = DigitChar(digit & mask);
   }
+  return out;
+}
+
+void ReadPowerOfTwo(const char* first, const char* last, int bits,
+                    BigInt::Limbs& limbs) {
+  int64_t total = (last - first) * static_cast<int64_t>(bits);
+  limbs.assign((total + 63) / 64, 0);
+  int64_t bit = 0;
+  for (const char* cur = last; cur != first; bit += bits) {
+    Limb digit = DigitValue(*--cur);
+    int64_t limb = bit / 64;
+    int offset = static_cast<int>(bit % 64);
+    limbs[limb] |= digit << offset;
+    if (offset + bits > 64) {
+      limbs[limb + 1] |= digit >> (64 - offset);
+    }
+  }
+}
+
+void ReadBasecase(const char* first, const char* last, const Radix& radix,
+                  BigInt::Limbs& limbs) {
+  int64_t length = last - first;
+  limbs.clear();
+  limbs.reserve(length / radix.digits + 1);
+  int chunk = static_cast<int>(length % radix.digits);
+  if (chunk == 0) {
+    chunk = radix.digits;
+  }
+  for (; first != last; first += chunk, chunk = radix.digits) {
+    Limb cell = 0;
+    Limb scale = 1;
+    for (int i = 0; i < chunk; ++i) {
+      cell = cell * radix.base + DigitValue(first[i]);
+      scale *= radix.base;
+    }
+    Limb carry = MulSmallLimbs(limbs.data(), static_cast<int>(limbs.size()),
+                               scale, cell);
+    if (carry != 0) {
+      limbs.push_back(carry);
+    }
+  }
+}
+
+}  // namespace
+
+BigInt::Limbs::Limbs()
+    : data_(inline_),
+      size_(0),
+      capacity_(kInlineLimbs),
+      scope_(current_scope),
+      heap_(false) {}
+
+BigInt::Limbs::Limbs(const Limbs& other) : Limbs() {
+  assign(other.begin(), other.end());
+}
+
+BigInt::Limbs::Limbs(Limbs&& other) noexcept : Limbs() {
+  *this = std::move(other);
+}
+
+BigInt::Limbs::~Limbs() { Release(); }
+
+BigInt::Limbs& BigInt::Limbs::operator=(const Limbs& other) {
+  if (this != &other) {
+    assign(other.begin(), other.end());
+  }
+  return *this;
+}
+
+BigInt::Limbs& BigInt::Limbs::operator=(Limbs&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  if (!other.IsInline() && CanTake(other)) {
+    Release();
+    Take(other);
+  } else {
+    assign(other.begin(), other.end());
+  }
+  other.clear();
+  return *this;
+}
+
+bool BigInt::Limbs::CanTake(const Limbs& other) const {
+  return other.IsInline() || other.heap_ || other.scope_ == scope_;
+}
+
+// Moves other's out-of-line buffer into this, whose own must be released.
+void BigInt::Limbs::Take(Limbs& other) {
+  data_ = other.data_;
+  size_ = other.size_;
+  capacity_ = other.capacity_;
+  heap_ = other.heap_;
+  other.data_ = other.inline_;
+  other.size_ = 0;
+  other.capacity_ = kInlineLimbs;
+  other.heap_ = false;
+}
+
+void BigInt::Limbs::Release() {
+  if (heap_) {
+    delete[] data_;
+  }
+}
+
+// Allocating from the arena while a scope nested inside scope_ is alive
+// would hand out memory that scope rolls back.
+void BigInt::Limbs::Grow(size_t capacity) {
+  capacity = std::max(capacity, 2 * capacity_);
+  bool heap = scope_ == nullptr || scope_->arena_.scope_ != scope_;
+  Limb* data = heap ? new Limb[capacity] : scope_->arena_.Allocate(capacity);
+  std::copy(data_, data_ + size_, data);
+  Release();
+  data_ = data;
+  capacity_ = capacity;
+  heap_ = heap;
+}
+
+void BigInt::Limbs::reserve(size_t capacity) {
+  if (capacity > capacity_) {
+    Grow(capacity);
+  }
+}
+
+void BigInt::Limbs::resize(size_t size, Limb value) {
+  reserve(size);
+  if (size > size_) {
+    std::fill(data_ + size_, data_ + size, value);
+  }
+  size_ = size;
+}
+
+void BigInt::Limbs::assign(const Limb* first, const Limb* last) {
+  size_ = 0;
+  reserve(last - first);
+  std::copy(first, last, data_);
+  size_ = last - first;
+}
+
+void BigInt::Limbs::assign(size_t count, Limb value) {
+  size_ = 0;
+  resize(count, value);
+}
+
+void BigInt::Limbs::push_back(Limb value) {
+  if (size_ == capacity_) {
+    Grow(size_ + 1);
+  }
+  data_[size_++] = value;
+}
+
+void BigInt::Limbs::swap(Limbs& other) {
+  if (!CanTake(other) || !other.CanTake(*this)) {
+    // An arena buffer cannot leave its scope, exchange the contents instead.
+    Limbs copy(*this);
+    assign(other.begin(), other.end());
+    other.assign(copy.begin(), copy.end());
+    return;
+  }
+  if (!IsInline() && !other.IsInline()) {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(heap_, other.heap_);
+    return;
+  }
+  if (IsInline() && other.IsInline()) {
+    std::swap(inline_, other.inline_);
+    std::swap(size_, other.size_);
+    return;
+  }
+  Limbs& heap = IsInline() ? other : *this;
+  Limbs& local = IsInline() ? *this : other;
+  Limbs moved;
+  moved.Take(heap);
+  std::copy(local.inline_, local.inline_ + local.size_, heap.inline_);
+  heap.size_ = local.size_;
+  local.Take(moved);
+}
+
+BigInt::Arena::Arena(size_t block_limbs)
+    : block_limbs_(std::max<size_t>(block_limbs, 1)),
+      block_(0),
+      used_(0),
+      scope_(nullptr) {}
+
+BigInt::Arena::~Arena() {
+  for (Block& block : blocks_) {
+    delete[] block.data;
+  }
+}
+
+BigInt::Limb* BigInt::Arena::Allocate(size_t count) {
+  for (; block_ < blocks_.size(); ++block_, used_ = 0) {
+    if (count <= blocks_[block_].capacity - used_) {
+      Limb* res = blocks_[block_].data + used_;
+      used_ += count;
+      return res;
+    }
+  }
+  size_t capacity = blocks_.empty() ? block_limbs_
+                                    : 2 * blocks_.back().capacity;
+  capacity = std::max(capacity, count);
+  blocks_.push_back({new Limb[capacity], capacity});
+  block_ = blocks_.size() - 1;
+  used_ = count;
+  return blocks_.back().data;
+}
+
+void BigInt::Arena::Reset() {
+  block_ = 0;
+  used_ = 0;
+}
+
+BigInt::ArenaScope::ArenaScope(Arena& arena)
+    : arena_(arena),
+      previous_(current_scope),
+      outer_(arena.scope_),
+      block_(arena.block_),
+      used_(arena.used_) {
+  current_scope = this;
+  arena.scope_ = this;
+}
+
+BigInt::ArenaScope::~ArenaScope() {
+  current_scope = previous_;
+  arena_.scope_ = outer_;
+  arena_.block_ = block_;
+  arena_.used_ = used_;
+}
+
+BigInt::Accumulator& BigInt::Accumulator::operator+=(const BigInt& big) {
+  Add(big, big.is_negative_);
+  return *this;
+}
+
+BigInt::Accumulator& BigInt::Accumulator::operator-=(const BigInt& big) {
+  Add(big, !big.is_negative_);
+  return *this;
+}
+
+void BigInt::Accumulator::Add(const BigInt& big, bool negative) {
+  // Lanes below 2^32 take 2^32 - 1 more halves without overflowing.
+  if (count_ == 0xffffffff) {
+    Normalize();
+  }
+  ++count_;
+  Limbs& lanes = lanes_[negative ? 1 : 0];
+  if (lanes.size() < 2 * static_cast<size_t>(big.size_)) {
+    lanes.resize(2 * big.size_);
+  }
+  AddHalves(lanes.data(), big.biginteger_.data(), big.size_);
+}
+
+void BigInt::Accumulator::Normalize() {
+  for (Limbs& lanes : lanes_) {
+    Limb carry = 0;
+    for (Limb& lane : lanes) {
+      Limb value = lane + carry;
+      lane = static_cast<uint32_t>(value);
+      carry = value >> 32;
+    }
+    for (; carry != 0; carry >>= 32) {
+      lanes.push_back(static_cast<uint32_t>(carry));
+    }
+    if (lanes.size() % 2 != 0) {
+      lanes.push_back(0);
+    }
+  }
+  count_ = 1;
+}
+
+BigInt BigInt::Accumulator::Total() const {
+  BigInt sums[2];
+  for (int sign = 0; sign < 2; ++sign) {
+    const Limbs& lanes = lanes_[sign];
+    BigInt& sum = sums[sign];
+    int size = static_cast<int>(lanes.size() / 2);
+    sum.biginteger_.resize(size + 2);
+    DoubleLimb carry = 0;
+    for (int i = 0; i < size; ++i) {
+      carry += lanes[2 * i];
+      carry += static_cast<DoubleLimb>(lanes[2 * i + 1]) << 32;
+      sum.biginteger_[i] = static_cast<Limb>(carry);
+      carry >>= 64;
+    }
+    sum.biginteger_[size] = static_cast<Limb>(carry);
+    sum.biginteger_[size + 1] = static_cast<Limb>(carry >> 64);
+    sum.size_ = size + 2;
+    sum.Trim();
+  }
+  return std::move(sums[0]) - sums[1];
+}
+
+void BigInt::Accumulator::Clear() {
+  lanes_[0].clear();
+  lanes_[1].clear();
+  count_ = 0;
+}
+
+// Sub-products of a parallel multiplication, run on the pool, and the
+// additions that assemble them, run afterwards in order.
+struct BigInt::MultiplyPlan {
+  std::vector<std::function<void()>> products;
+  std::vector<std::function<void()>> combines;
+  std::deque<Limbs> buffers;
+};
+
+BigInt::Tuning& BigInt::GetTuning() {
+  static Tuning tuning;
+  return tuning;
+}
+
+BigInt::BigInt() : size_(0), is_negative_(false) {}
+
+BigInt::BigInt(int64_t big) {
+  is_negative_ = big < 0;
+  Limb bigint = is_negative_ ? 0 - static_cast<Limb>(big) : big;
+  size_ = 0;
+  if (bigint != 0) {
+    biginteger_.push_back(bigint);
+    size_ = 1;
+  }
+}
+
+BigInt::BigInt(std::string bigstring) : size_(0), is_negative_(false) {
+  const char* last = bigstring.data() + bigstring.size();
+  std::from_chars_result res = FromChars(bigstring.data(), last, *this);
+  if (res.ec != std::errc() || res.ptr != last) {
+    throw std::invalid_argument("BigInt: not an integer: " + bigstring);
+  }
+}
+
+BigInt::Limbs& BigInt::Data() { return biginteger_; }
+
+const BigInt::Limbs& BigInt::Data() const { return biginteger_; }
+
+int& BigInt::Size() { return size_; }
+
+int BigInt::Size() const { return size_; }
+
+bool& BigInt::Negative() { return is_negative_; }
+
+bool BigInt::Negative() const { return is_negative_; }
+
+void BigInt::Trim() {
+  while (size_ > 0 && biginteger_[size_ - 1] == 0) {
+    --size_;
+  }
+  biginteger_.resize(size_);
+  if (size_ == 0) {
+    is_negative_ = false;
+  }
+}
+
+void BigInt::Swap(BigInt& big) {
+  biginteger_.swap(big.biginteger_);
+  std::swap(size_, big.size_);
+  std::swap(is_negative_, big.is_negative_);
+}
+
+std::ostream& operator<<(std::ostream& ostream, const BigInt& big) {
+  const size_t kStackChars = 128;
+  size_t bound = big.CharsBound();
+  if (bound <= kStackChars) {
+    char buffer[kStackChars];
+    std::to_chars_result res =
+        BigInt::ToChars(buffer, buffer + kStackChars, big);
+    ostream.write(buffer, res.ptr - buffer);
+    return ostream;
+  }
+  std::unique_ptr<char[]> buffer(new char[bound]);
+  std::to_chars_result res =
+      BigInt::ToChars(buffer.get(), buffer.get() + bound, big);
+  ostream.write(buffer.get(), res.ptr - buffer.get());
+  return ostream;
+}
+
+size_t BigInt::CharsBound(int base) const {
+  if (base < 2 || base > 36) {
+    return 0;
+  }
+  if (size_ == 0) {
+    return 1;
+  }
+  double bits = 64.0 * size_ - __builtin_clzll(biginteger_[size_ - 1]);
+  return static_cast<size_t>(bits / std::log2(base)) + 2 + is_negative_;
+}
+
+// Accepts an optional '+' or '-' followed by digits of the given base,
+// letters in either case. Power-of-two bases and short inputs are read into
+// the limb buffer of value, longer ones are built by divide and conquer and
+// moved into value. Without digits value is left untouched and
+// invalid_argument is returned.
+std::from_chars_result BigInt::FromChars(const char* first, const char* last,
+                                         BigInt& value, int base) {
+  if (base < 2 || base > 36) {
+    return {first, std::errc::invalid_argument};
+  }
+  const char* digits = first;
+  bool negative = false;
+  if (digits != last && (*digits == '-' || *digits == '+')) {
+    negative = *digits == '-';
+    ++digits;
+  }
+  const char* cur = digits;
+  while (cur != last && DigitValue(*cur) < base) {
+    ++cur;
+  }
+  if (cur == digits) {
+    return {first, std::errc::invalid_argument};
+  }
+  Radix radix = MakeRadix(base);
+  if (radix.bits != 0) {
+    ReadPowerOfTwo(digits, cur, radix.bits, value.biginteger_);
+  } else if (cur - digits <=
+             static_cast<int64_t>(radix.digits) * kRadixThreshold) {
+    ReadBasecase(digits, cur, radix, value.biginteger_);
+  } else {
+    std::vector<BigInt> powers;
+    value = ReadDigits(digits, cur, base, powers);
+  }
+  value.size_ = static_cast<int>(value.biginteger_.size());
+  value.is_negative_ = negative;
+  value.Trim();
+  return {cur, std::errc()};
+}
+
+// Subquadratic for non-power-of-two bases: the magnitude is split by
+// base^(digits * 2^k) and both halves are written recursively.
+std::to_chars_result BigInt::ToChars(char* first, char* last,
+                                     const BigInt& value, int base) {
+  if (base < 2 || base > 36) {
+    return {first, std::errc::invalid_argument};
+  }
+  size_t bound = value.CharsBound(base);
+  if (static_cast<size_t>(last - first) < bound) {
+    std::unique_ptr<char[]> buffer(new char[bound]);
+    std::to_chars_result res =
+        ToChars(buffer.get(), buffer.get() + bound, value, base);
+    if (res.ptr - buffer.get() > last - first) {
+      return {last, std::errc::value_too_large};
+    }
+    return {std::copy(buffer.get(), res.ptr, first), std::errc()};
+  }
+  if (value.size_ == 0) {
+    *first = '0';
+    return {first + 1, std::errc()};
+  }
+  char* out = first;
+  if (value.is_negative_) {
+    *out++ = '-';
+  }
+  Radix radix = MakeRadix(base);
+  if (radix.bits != 0) {
+    out = WritePowerOfTwo(value.biginteger_.data(), value.size_, radix.bits,
+                          out);
+    return {out, std::errc()};
+  }
+  BigInt magnitude = Abs(value);
+  std::vector<BigInt> powers;
+  std::vector<BigInt> reciprocals;
+  if (value.size_ > kRadixThreshold) {
+    powers.push_back(FromLimbs(&radix.cell, 1));
+    while (2 * (powers.back().size_ - 1) < value.size_) {
+      powers.push_back(powers.back() * powers.back());
+    }
+    reciprocals.resize(powers.size());
+    for (size_t i = 0; i < powers.size(); ++i) {
+      if (powers[i].size_ >= kBarrettThreshold) {
+        reciprocals[i] = Reciprocal(powers[i]);
+      }
+    }
+  }
+  out = WriteDigits(magnitude, static_cast<int>(powers.size()) - 1, base,
+                    powers, reciprocals, -1, out);
+  return {out, std::errc()};
+}
+
+BigInt BigInt::ReadDigits(const char* first, const char* last, int base,
+                          std::vector<BigInt>& powers) {
+  Radix radix = MakeRadix(base);
+  int64_t length = last - first;
+  if (length <= static_cast<int64_t>(radix.digits) * kRadixThreshold) {
+    BigInt value;
+    ReadBasecase(first, last, radix, value.biginteger_);
+    value.size_ = static_cast<int>(value.biginteger_.size());
+    value.Trim();
+    return value;
+  }
+  size_t level = 0;
+  int64_t width = radix.digits;
+  while (2 * width < length) {
+    width *= 2;
+    ++level;
+  }
+  while (powers.size() <= level) {
+    if (powers.empty()) {
+      powers.push_back(FromLimbs(&radix.cell, 1));
+    } else {
+      powers.push_back(powers.back() * powers.back());
+    }
+  }
+  BigInt value = ReadDigits(first, last - width, base, powers);
+  value *= powers[level];
+  value += ReadDigits(last - width, last, base, powers);
+  return value;
+}
+
+// Writes value < powers[level + 1], padded to width digits when width >= 0,
+// by splitting it with powers[level]. Clobbers value.
+char* BigInt::WriteDigits(BigInt& value, int level, int base,
+                          const std::vector<BigInt>& powers,
+                          const std::vector<BigInt>& reciprocals,
+                          int64_t width, char* out) {
+  Radix radix = MakeRadix(base);
+  if (level < 0 || value.size_ <= kRadixThreshold) {
+    return WriteBasecase(value.biginteger_.data(), value.size_, radix, width,
+                         out);
+  }
+  const BigInt& power = powers[level];
+  if (width < 0 && CompareLimbs(value.biginteger_.data(), value.size_,
+                                power.biginteger_.data(), power.size_) < 0) {
+    return WriteDigits(value, level - 1, base, powers, reciprocals, -1, out);
+  }
+  BigInt quotient;
+  BigInt remainder;
+  if (power.size_ >= kBarrettThreshold) {
+    DivModBarrett(value, power, reciprocals[level], quotient, remainder);
+  } else {
+    DivMod(value, power, quotient, remainder);
+  }
+  int64_t half = static_cast<int64_t>(radix.digits) << level;
+  out = WriteDigits(quotient, level - 1, base, powers, reciprocals,
+                    width < 0 ? -1 : half, out);
+  return WriteDigits(remainder, level - 1, base, powers, reciprocals, half,
+                     out);
+}
+
+// floor(B^(2n) / divisor) for a positive divisor of n limbs. Large divisors
+// take one Newton step from the reciprocal of their top half, so the cost is
+// a few multiplications of size n.
+BigInt BigInt::Reciprocal(const BigInt& divisor) {
+  int size = divisor.size_;
+  BigInt power = 1;
+  power.ShiftLimbs(2 * size);
+  if (size <= kReciprocalThreshold) {
+    BigInt quotient;
+    BigInt remainder;
+    DivMod(power, divisor, quotient, remainder);
+    return quotient;
+  }
+  int high = size / 2 + 2;
+  BigInt approx = Reciprocal(
+      FromLimbs(divisor.biginteger_.data() + size - high, high));
+  approx.ShiftLimbs(size - high);
+  BigInt residual = power - divisor * approx;
+  BigInt correction = approx * residual;
+  correction.ShiftLimbs(-2 * size);
+  approx += correction;
+  residual = power - divisor * approx;
+  while (residual.is_negative_) {
+    --approx;
+    residual += divisor;
+  }
+  while (CompareLimbs(residual.biginteger_.data(), residual.size_,
+                      divisor.biginteger_.data(), divisor.size_) >= 0) {
+    ++approx;
+    residual -= divisor;
+  }
+  return approx;
+}
+
+// Barrett division of 0 <= dividend < B^(2n) by a positive divisor of n limbs
+// with reciprocal = Reciprocal(divisor).
+void BigInt::DivModBarrett(const BigInt& dividend, const BigInt& divisor,
+                           const BigInt& reciprocal, BigInt& quotient,
+                           BigInt& remainder) {
+  int size = divisor.size_;
+  BigInt quot = dividend;
+  quot.ShiftLimbs(1 - size);
+  quot *= reciprocal;
+  quot.ShiftLimbs(-size - 1);
+  BigInt rem = dividend - quot * divisor;
+  while (CompareLimbs(rem.biginteger_.data(), rem.size_,
+                      divisor.biginteger_.data(), divisor.size_) >= 0) {
+    rem -= divisor;
+    ++quot;
+  }
+  quotient = std::move(quot);
+  remainder = std::move(rem);
+}
+
+// Multiplies the magnitude by B^count, or drops -count low limbs when count
+// is negative.
+void BigInt::ShiftLimbs(int count) {
+  if (size_ == 0 || count == 0) {
+    return;
+  }
+  if (count > 0) {
+    biginteger_.resize(size_ + count);
+    std::copy_backward(biginteger_.data(), biginteger_.data() + size_,
+                       biginteger_.data() + size_ + count);
+    std::fill(biginteger_.data(), biginteger_.data() + count, 0);
+    size_ += count;
+    return;
+  }
+  if (-count >= size_) {
+    size_ = 0;
+    Trim();
+    return;
+  }
+  std::copy(biginteger_.data() - count, biginteger_.data() + size_,
+            biginteger_.data());
+  size_ += count;
+  Trim();
+}
+
+BigInt::BigInt(const BigInt& copy) {
+  biginteger_ = copy.biginteger_;
+  size_ = copy.size_;
+  is_negative_ = copy.is_negative_;
+}
+
+BigInt::BigInt(BigInt&& other) noexcept
+    : biginteger_(std::move(other.biginteger_)),
+      size_(other.size_),
+      is_negative_(other.is_negative_) {
+  other.biginteger_.clear();
+  other.size_ = 0;
+  other.is_negative_ = false;
+}
+
+BigInt& BigInt::operator=(const BigInt& copy) {
+  if (this == &copy) {
+    return *this;
+  }
+  biginteger_ = copy.biginteger_;
+  is_negative_ = copy.is_negative_;
+  size_ = copy.size_;
+  return *this;
+}
+
+BigInt& BigInt::operator=(BigInt&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  biginteger_ = std::move(other.biginteger_);
+  size_ = other.size_;
+  is_negative_ = other.is_negative_;
+  other.size_ = 0;
+  other.is_negative_ = false;
+  return *this;
+}
+
+int BigInt::Compare(const BigInt& big) const {
+  if (is_negative_ != big.is_negative_) {
+    return is_negative_ ? -1 : 1;
+  }
+  int res = CompareLimbs(biginteger_.data(), size_, big.biginteger_.data(),
+                         big.size_);
+  return is_negative_ ? -res : res;
+}
+
+int BigInt::CompareAbs(const BigInt& left, const BigInt& right) {
+  return CompareLimbs(left.biginteger_.data(), left.size_,
+                      right.biginteger_.data(), right.size_);
+}
+
+#ifdef __cpp_lib_three_way_comparison
+std::strong_ordering BigInt::operator<=>(const BigInt& big) const {
+  return Compare(big) <=> 0;
+}
+#endif
+
+bool BigInt::operator==(const BigInt& big) const {
+  return size_ == big.size_ && is_negative_ == big.is_negative_ &&
+         std::equal(biginteger_.begin(), biginteger_.end(),
+                    big.biginteger_.begin());
+}
+
+BigInt Abs(const BigInt& big) {
+  BigInt bigabs = big;
+  bigabs.Negative() = false;
+  return bigabs;
+}
+
+BigInt Abs(BigInt&& big) {
+  big.Negative() = false;
+  return std::move(big);
+}
+
+bool BigInt::operator<(const BigInt& big) const { return Compare(big) < 0; }
+
+bool BigInt::operator<=(const BigInt& big) const { return Compare(big) <= 0; }
+
+bool BigInt::operator>(const BigInt& big) const { return Compare(big) > 0; }
+
+bool BigInt::operator>=(const BigInt& big) const { return Compare(big) >= 0; }
+
+bool BigInt::operator!=(const BigInt& big) const { return !(*this == big); }
+
+std::istream& operator>>(std::istream& istream, BigInt& big) {
+  std::string strint;
+  if (!(istream >> strint)) {
+    return istream;
+  }
+  // Parsed aside, so that big is left untouched unless the whole word is
+  // an integer.
+  BigInt value;
+  const char* last = strint.data() + strint.size();
+  std::from_chars_result res = BigInt::FromChars(strint.data(), last, value);
+  if (res.ec != std::errc() || res.ptr != last) {
+    istream.setstate(std::ios_base::failbit);
+    return istream;
+  }
+  big = std::move(value);
+  return istream;
+}
+
+BigInt& BigInt::operator+=(const BigInt& big) {
+  if (is_negative_ != big.is_negative_) {
+    MinusPart(big, big.is_negative_);
+    return *this;
+  }
+  AddPart(big);
+  return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& big) {
+  if (is_negative_ == big.is_negative_) {
+    MinusPart(big, !big.is_negative_);
+    return *this;
+  }
+  AddPart(big);
+  return *this;
+}
+
+// Adds the magnitude of big to the magnitude of *this.
+void BigInt::AddPart(const BigInt& big) {
+  Limb carry;
+  if (size_ < big.size_) {
+    biginteger_.resize(big.size_);
+    carry = AddLimbs(biginteger_.data(), big.biginteger_.data(), big.size_,
+                     biginteger_.data(), size_);
+    size_ = big.size_;
+  } else {
+    carry = AddLimbs(biginteger_.data(), biginteger_.data(), size_,
+                     big.biginteger_.data(), big.size_);
+  }
+  if (carry != 0) {
+    biginteger_.push_back(carry);
+    ++size_;
+  }
+}
+
+// Adds big with the sign big_negative to *this when the signs differ, so the
+// magnitudes are subtracted in place.
+void BigInt::MinusPart(const BigInt& big, bool big_negative) {
+  if (CompareLimbs(biginteger_.data(), size_, big.biginteger_.data(),
+                   big.size_) >= 0) {
+    SubLimbs(biginteger_.data(), biginteger_.data(), size_,
+             big.biginteger_.data(), big.size_);
+  } else {
+    biginteger_.resize(big.size_);
+    SubLimbs(biginteger_.data(), big.biginteger_.data(), big.size_,
+             biginteger_.data(), size_);
+    size_ = big.size_;
+    is_negative_ = big_negative;
+  }
+  Trim();
+}
+
+BigInt& BigInt::operator*=(const BigInt& big) {
+  if (size_ == 0 || big.size_ == 0) {
+    biginteger_.clear();
+    size_ = 0;
+    is_negative_ = false;
+    return *this;
+  }
+  Limbs product;
+  product.resize(size_ + big.size_);
+  MultiplyLimbs(product.data(), biginteger_.data(), size_,
+                big.biginteger_.data(), big.size_);
+  biginteger_ = std::move(product);
+  size_ += big.size_;
+  is_negative_ = is_negative_ != big.is_negative_;
+  Trim();
+  return *this;
+}
+
+BigInt BigInt::FromLimbs(const Limb* limbs, int size) {
+  BigInt big;
+  big.biginteger_.assign(limbs, limbs + size);
+  big.size_ = size;
+  big.Trim();
+  return big;
+}
+
+// Chooses the multiplication algorithm by operand size, squaring when both
+// operands are the same limbs.
+void BigInt::MultiplyLimbs(Limb* res, const Limb* left, int left_size,
+                           const Limb* right, int right_size) {
+  if (left_size < right_size) {
+    std::swap(left, right);
+    std::swap(left_size, right_size);
+  }
+  const Tuning& tuning = GetTuning();
+  bool square = left == right && left_size == right_size;
+  int threads = 1;
+  if (right_size >= tuning.parallel_threshold && !serial_multiply) {
+    threads = tuning.threads > 0
+                  ? tuning.threads
+                  : static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (right_size >= tuning.ntt_threshold && NttFits(left_size, right_size)) {
+    NttMultiply(res, left, left_size, right, right_size, threads);
+    return;
+  }
+  if (threads > 1) {
+    MultiplyPlan plan;
+    PlanMultiply(res, left, left_size, right, right_size, threads, plan);
+    RunProducts(plan.products, threads);
+    for (std::function<void()>& combine : plan.combines) {
+      combine();
+    }
+    return;
+  }
+  if (right_size < KaratsubaThreshold()) {
+    if (square) {
+      SqrLimbs(res, left, left_size);
+    } else {
+      MulLimbs(res, left, left_size, right, right_size);
+    }
+    return;
+  }
+  if (right_size < Toom3Threshold()) {
+    Limbs scratch;
+    scratch.resize(KaratsubaScratch(left_size) + 2 * left_size);
+    if (square) {
+      KaratsubaSquare(res, left, left_size, scratch.data());
+    } else {
+      Karatsuba(res, left, left_size, right, right_size, scratch.data());
+    }
+    return;
+  }
+  int third = (left_size + 2) / 3;
+  if (right_size > 2 * third) {
+    Toom3(res, left, left_size, right, right_size);
+    return;
+  }
+  Limbs product;
+  product.resize(2 * right_size);
+  std::fill(res, res + left_size + right_size, 0);
+  for (int offset = 0; offset < left_size; offset += right_size) {
+    int piece = std::min(right_size, left_size - offset);
+    MultiplyLimbs(product.data(), left + offset, piece, right, right_size);
+    AddLimbs(res + offset, res + offset, piece + right_size, product.data(),
+             piece + right_size);
+  }
+}
+
+// Splits res = left * right into about tasks independent products. Balanced
+// operands take one Karatsuba step, giving three half-size products, and
+// unbalanced ones are cut into blocks of the longer operand.
+void BigInt::PlanMultiply(Limb* res, const Limb* left, int left_size,
+                          const Limb* right, int right_size, int tasks,
+                          MultiplyPlan& plan) {
+  if (left_size < right_size) {
+    std::swap(left, right);
+    std::swap(left_size, right_size);
+  }
+  if (tasks <= 1 || right_size < 2 * KaratsubaThreshold()) {
+    plan.products.push_back([=] {
+      MultiplyLimbs(res, left, left_size, right, right_size);
+    });
+    return;
+  }
+  int half = (left_size + 1) / 2;
+  if (right_size <= half) {
+    int block = std::max(right_size, (left_size + tasks - 1) / tasks);
+    int blocks = (left_size + block - 1) / block;
+    std::vector<Limb*> products;
+    for (int offset = 0; offset < left_size; offset += block) {
+      int piece = std::min(block, left_size - offset);
+      Limbs& product = plan.buffers.emplace_back();
+      product.resize(piece + right_size);
+      products.push_back(product.data());
+      PlanMultiply(product.data(), left + offset, piece, right, right_size,
+                   tasks / blocks, plan);
+    }
+    plan.combines.push_back([=] {
+      int size = left_size + right_size;
+      std::fill(res, res + size, 0);
+      for (int i = 0; i < blocks; ++i) {
+        int offset = i * block;
+        int piece = std::min(block, left_size - offset);
+        AddLimbs(res + offset, res + offset, size - offset, products[i],
+                 piece + right_size);
+      }
+    });
+    return;
+  }
+  int left_high = left_size - half;
+  int right_high = right_size - half;
+  bool square = left == right && left_size == right_size;
+  Limbs& left_sum = plan.buffers.emplace_back();
+  left_sum.resize(half + 1);
+  left_sum[half] =
+      AddLimbs(left_sum.data(), left, half, left + half, left_high);
+  const Limb* right_sum = left_sum.data();
+  if (!square) {
+    Limbs& sum = plan.buffers.emplace_back();
+    sum.resize(half + 1);
+    sum[half] = AddLimbs(sum.data(), right, half, right + half, right_high);
+    right_sum = sum.data();
+  }
+  Limbs& middle = plan.buffers.emplace_back();
+  middle.resize(2 * half + 2);
+  int sub_tasks = (tasks + 2) / 3;
+  PlanMultiply(res, left, half, right, half, sub_tasks, plan);
+  PlanMultiply(res + 2 * half, left + half, left_high, right + half,
+               right_high, sub_tasks, plan);
+  PlanMultiply(middle.data(), left_sum.data(), half + 1, right_sum, half + 1,
+               sub_tasks, plan);
+  Limb* mid = middle.data();
+  plan.combines.push_back([=] {
+    int mid_size = 2 * half + 2;
+    SubLimbs(mid, mid, mid_size, res, 2 * half);
+    SubLimbs(mid, mid, mid_size, res + 2 * half, left_high + right_high);
+    while (mid_size > 0 && mid[mid_size - 1] == 0) {
+      --mid_size;
+    }
+    AddLimbs(res + half, res + half, left_size + right_size - half, mid,
+             mid_size);
+  });
+}
+
+// Toom-Cook 3 with evaluation points 0, 1, -1, -2, infinity and Bodrato's
+// interpolation sequence. Requires right_size > 2 * ceil(left_size / 3).
+void BigInt::Toom3(Limb* res, const Limb* left, int left_size,
+                   const Limb* right, int right_size) {
+  int third = (left_size + 2) / 3;
+  bool square = left == right && left_size == right_size;
+  BigInt left0 = FromLimbs(left, third);
+  BigInt left1 = FromLimbs(left + third, third);
+  BigInt left2 = FromLimbs(left + 2 * third, left_size - 2 * third);
+  BigInt tmp = left0 + left2;
+  BigInt left_m1 = tmp - left1;
+  BigInt left_p1 = tmp + left1;
+  BigInt left_m2 = left_m1 + left2;
+  left_m2 += left_m2;
+  left_m2 -= left0;
+  BigInt res0;
+  BigInt res1;
+  BigInt res_m1;
+  BigInt res_m2;
+  BigInt res_inf;
+  if (square) {
+    res0 = left0 * left0;
+    res1 = left_p1 * left_p1;
+    res_m1 = left_m1 * left_m1;
+    res_m2 = left_m2 * left_m2;
+    res_inf = left2 * left2;
+  } else {
+    BigInt right0 = FromLimbs(right, third);
+    BigInt right1 = FromLimbs(right + third, third);
+    BigInt right2 = FromLimbs(right + 2 * third, right_size - 2 * third);
+    tmp = right0 + right2;
+    BigInt right_m1 = tmp - right1;
+    BigInt right_p1 = tmp + right1;
+    BigInt right_m2 = right_m1 + right2;
+    right_m2 += right_m2;
+    right_m2 -= right0;
+    res0 = left0 * right0;
+    res1 = left_p1 * right_p1;
+    res_m1 = left_m1 * right_m1;
+    res_m2 = left_m2 * right_m2;
+    res_inf = left2 * right2;
+  }
+  BigInt res3 = res_m2 - res1;
+  DivSmallLimbs(res3.biginteger_.data(), res3.size_, 3);
+  res3.Trim();
+  res1 -= res_m1;
+  res1.DivisionByTwo();
+  BigInt res2 = res_m1 - res0;
+  res3 = res2 - std::move(res3);
+  res3.DivisionByTwo();
+  res3 += res_inf;
+  res3 += res_inf;
+  res2 += res1;
+  res2 -= res_inf;
+  res1 -= res3;
+  int total = left_size + right_size;
+  std::fill(res, res + total, 0);
+  const BigInt* coefficients[] = {&res0, &res1, &res2, &res3, &res_inf};
+  for (int i = 0; i < 5; ++i) {
+    int offset = i * third;
+    AddLimbs(res + offset, res + offset, total - offset,
+             coefficients[i]->biginteger_.data(), coefficients[i]->size_);
+  }
+}
+
+BigInt operator*(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt multiply = lvalue;
+  if (&lvalue == &rvalue) {
+    multiply *= multiply;
+    return multiply;
+  }
+  multiply *= rvalue;
+  return multiply;
+}
+
+BigInt operator*(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue *= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator*(const BigInt& lvalue, BigInt&& rvalue) {
+  rvalue *= lvalue;
+  return std::move(rvalue);
+}
+
+BigInt operator*(BigInt&& lvalue, BigInt&& rvalue) {
+  lvalue *= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator+(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt multiply = lvalue;
+  multiply += rvalue;
+  return multiply;
+}
+
+BigInt operator+(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue += rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator+(const BigInt& lvalue, BigInt&& rvalue) {
+  rvalue += lvalue;
+  return std::move(rvalue);
+}
+
+BigInt operator+(BigInt&& lvalue, BigInt&& rvalue) {
+  if (lvalue.Data().capacity() < rvalue.Data().capacity()) {
+    rvalue += lvalue;
+    return std::move(rvalue);
+  }
+  lvalue += rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator/(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt quotient;
+  BigInt remainder;
+  BigInt::DivMod(lvalue, rvalue, quotient, remainder);
+  return quotient;
+}
+
+BigInt operator/(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue /= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator-(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt multiply = lvalue;
+  multiply -= rvalue;
+  return multiply;
+}
+
+BigInt operator-(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue -= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator-(const BigInt& lvalue, BigInt&& rvalue) {
+  rvalue -= lvalue;
+  return -std::move(rvalue);
+}
+
+BigInt operator-(BigInt&& lvalue, BigInt&& rvalue) {
+  lvalue -= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator%(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt quotient;
+  BigInt remainder;
+  BigInt::DivMod(lvalue, rvalue, quotient, remainder);
+  return remainder;
+}
+
+BigInt operator%(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue %= rvalue;
+  return std::move(lvalue);
+}
+
+void BigInt::DivisionByTwo() {
+  ShiftRightLimbs(biginteger_.data(), biginteger_.data(), size_, 1);
+  Trim();
+}
+
+BigInt& BigInt::operator<<=(int shift) {
+  if (shift < 0) {
+    return *this >>= -shift;
+  }
+  if (size_ == 0 || shift == 0) {
+    return *this;
+  }
+  int limbs = shift / 64;
+  biginteger_.resize(size_ + limbs + 1);
+  Limb* data = biginteger_.data();
+  data[size_ + limbs] = ShiftLeftLimbs(data + limbs, data, size_, shift % 64);
+  std::fill(data, data + limbs, 0);
+  size_ += limbs + 1;
+  Trim();
+  return *this;
+}
+
+BigInt& BigInt::operator>>=(int shift) {
+  if (shift < 0) {
+    return *this <<= -shift;
+  }
+  if (size_ == 0 || shift == 0) {
+    return *this;
+  }
+  bool negative = is_negative_;
+  int limbs = shift / 64;
+  if (limbs >= size_) {
+    biginteger_.clear();
+    size_ = 0;
+    is_negative_ = false;
+    if (negative) {
+      AddSmallPart(1, true);
+    }
+    return *this;
+  }
+  Limb* data = biginteger_.data();
+  bool inexact = std::any_of(data, data + limbs, [](Limb limb) {
+    return limb != 0;
+  });
+  Limb lost = ShiftRightLimbs(data, data + limbs, size_ - limbs, shift % 64);
+  inexact |= lost != 0;
+  size_ -= limbs;
+  Trim();
+  if (negative && inexact) {
+    AddSmallPart(1, true);
+  }
+  return *this;
+}
+
+// Applies op limb by limb to the two's complement forms of *this and big,
+// converting negative magnitudes on the fly with ~x + 1. One extra limb holds
+// the sign extension of both operands.
+template <typename Op>
+void BigInt::BitwisePart(const BigInt& big, Op op) {
+  int size = std::max(size_, big.size_) + 1;
+  Limb left_mask = is_negative_ ? ~Limb{0} : 0;
+  Limb right_mask = big.is_negative_ ? ~Limb{0} : 0;
+  Limb res_mask = op(left_mask, right_mask);
+  Limb left_carry = left_mask & 1;
+  Limb right_carry = right_mask & 1;
+  Limb res_carry = res_mask & 1;
+  int left_size = size_;
+  int right_size = big.size_;
+  biginteger_.resize(size);
+  for (int i = 0; i < size; ++i) {
+    Limb left = (i < left_size ? biginteger_[i] : 0) ^ left_mask;
+    left += left_carry;
+    left_carry &= static_cast<Limb>(left == 0);
+    Limb right = (i < right_size ? big.biginteger_[i] : 0) ^ right_mask;
+    right += right_carry;
+    right_carry &= static_cast<Limb>(right == 0);
+    Limb res = (op(left, right) ^ res_mask) + res_carry;
+    res_carry &= static_cast<Limb>(res == 0);
+    biginteger_[i] = res;
+  }
+  size_ = size;
+  is_negative_ = res_mask != 0;
+  Trim();
+}
+
+BigInt& BigInt::operator&=(const BigInt& big) {
+  BitwisePart(big, [](Limb left, Limb right) { return left & right; });
+  return *this;
+}
+
+BigInt& BigInt::operator|=(const BigInt& big) {
+  BitwisePart(big, [](Limb left, Limb right) { return left | right; });
+  return *this;
+}
+
+BigInt& BigInt::operator^=(const BigInt& big) {
+  BitwisePart(big, [](Limb left, Limb right) { return left ^ right; });
+  return *this;
+}
+
+int64_t BigInt::PopCount() const {
+  int64_t count = 0;
+  for (int i = 0; i < size_; ++i) {
+    count += __builtin_popcountll(biginteger_[i]);
+  }
+  return count;
+}
+
+int64_t BigInt::BitLength() const {
+  if (size_ == 0) {
+    return 0;
+  }
+  return 64 * static_cast<int64_t>(size_) -
+         __builtin_clzll(biginteger_[size_ - 1]);
+}
+
+BigInt operator<<(const BigInt& lvalue, int shift) {
+  BigInt res = lvalue;
+  res <<= shift;
+  return res;
+}
+
+BigInt operator<<(BigInt&& lvalue, int shift) {
+  lvalue <<= shift;
+  return std::move(lvalue);
+}
+
+BigInt operator>>(const BigInt& lvalue, int shift) {
+  BigInt res = lvalue;
+  res >>= shift;
+  return res;
+}
+
+BigInt operator>>(BigInt&& lvalue, int shift) {
+  lvalue >>= shift;
+  return std::move(lvalue);
+}
+
+BigInt operator&(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt res = lvalue;
+  res &= rvalue;
+  return res;
+}
+
+BigInt operator&(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue &= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator|(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt res = lvalue;
+  res |= rvalue;
+  return res;
+}
+
+BigInt operator|(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue |= rvalue;
+  return std::move(lvalue);
+}
+
+BigInt operator^(const BigInt& lvalue, const BigInt& rvalue) {
+  BigInt res = lvalue;
+  res ^= rvalue;
+  return res;
+}
+
+BigInt operator^(BigInt&& lvalue, const BigInt& rvalue) {
+  lvalue ^= rvalue;
+  return std::move(lvalue);
+}
+
+// Adds value, or subtracts it when negative is set, without building a
+// temporary BigInt.
+void BigInt::AddSmallPart(Limb value, bool negative) {
+  if (value == 0) {
+    return;
+  }
+  if (size_ == 0) {
+    biginteger_.assign(1, value);
+    size_ = 1;
+    is_negative_ = negative;
+    return;
+  }
+  if (is_negative_ == negative) {
+    for (int i = 0; i < size_ && value != 0; ++i) {
+      biginteger_[i] += value;
+      value = static_cast<Limb>(biginteger_[i] < value);
+    }
+    if (value != 0) {
+      biginteger_.push_back(value);
+      ++size_;
+    }
+    return;
+  }
+  if (size_ == 1 && biginteger_[0] < value) {
+    biginteger_[0] = value - biginteger_[0];
+    is_negative_ = negative;
+    return;
+  }
+  for (int i = 0; value != 0; ++i) {
+    Limb cur = biginteger_[i];
+    biginteger_[i] = cur - value;
+    value = static_cast<Limb>(cur < value);
+  }
+  Trim();
+}
+
+BigInt& BigInt::AddSmall(Limb value) {
+  AddSmallPart(value, false);
+  return *this;
+}
+
+BigInt& BigInt::MulSmall(Limb value) {
+  if (value == 0 || size_ == 0) {
+    biginteger_.clear();
+    size_ = 0;
+    is_negative_ = false;
+    return *this;
+  }
+  Limb carry = MulSmallLimbs(biginteger_.data(), size_, value, 0);
+  if (carry != 0) {
+    biginteger_.push_back(carry);
+    ++size_;
+  }
+  return *this;
+}
+
+Limb BigInt::DivSmall(Limb divisor) {
+  Limb remainder = DivSmallLimbs(biginteger_.data(), size_, divisor);
+  Trim();
+  return remainder;
+}
+
+BigInt& BigInt::MulAdd(const BigInt& multiplier, Limb addend) {
+  if (multiplier.size_ == 1 && size_ != 0 &&
+      is_negative_ == multiplier.is_negative_) {
+    Limb carry = MulSmallLimbs(biginteger_.data(), size_,
+                               multiplier.biginteger_[0], addend);
+    if (carry != 0) {
+      biginteger_.push_back(carry);
+      ++size_;
+    }
+    is_negative_ = false;
+    return *this;
+  }
+  *this *= multiplier;
+  AddSmallPart(addend, false);
+  return *this;
+}
+
+BigInt& BigInt::operator++() {
+  AddSmallPart(1, false);
+  return *this;
+}
+
+BigInt& BigInt::operator--() {
+  AddSmallPart(1, true);
+  return *this;
+}
+
+BigInt BigInt::operator--(int) {
+  BigInt old = *this;
+  operator--();
+  return old;
+}
+
+BigInt BigInt::operator++(int) {
+  BigInt old = *this;
+  operator++();
+  return old;
+}
+
+BigInt BigInt::operator-() const& {
+  BigInt minus = *this;
+  if (minus.size_ != 0) {
+    minus.is_negative_ = !minus.is_negative_;
+  }
+  return minus;
+}
+
+BigInt BigInt::operator-() && {
+  if (size_ != 0) {
+    is_negative_ = !is_negative_;
+  }
+  return std::move(*this);
+}
+
+BigInt& BigInt::operator/=(const BigInt& big) {
+  BigInt remainder;
+  DivMod(*this, big, *this, remainder);
+  return *this;
+}
+
+BigInt& BigInt::operator%=(const BigInt& big) {
+  BigInt quotient;
+  DivMod(*this, big, quotient, *this);
   return *this;
-}
\ No newline at end of file
+}
+
+// Truncating division: the quotient rounds toward zero and the remainder takes
+// the sign of the dividend. quotient and remainder may alias the operands.
+void BigInt::DivMod(const BigInt& dividend, const BigInt& divisor,
+                    BigInt& quotient, BigInt& remainder) {
+  bool quotient_negative = dividend.is_negative_ != divisor.is_negative_;
+  bool remainder_negative = dividend.is_negative_;
+  if (CompareLimbs(dividend.biginteger_.data(), dividend.size_,
+                   divisor.biginteger_.data(), divisor.size_) < 0) {
+    remainder = dividend;
+    quotient = static_cast<int64_t>(0);
+    return;
+  }
+  if (divisor.size_ == 1) {
+    Limb small = divisor.biginteger_[0];
+    if (&quotient != &dividend) {
+      quotient = dividend;
+    }
+    small = DivSmallLimbs(quotient.biginteger_.data(), quotient.size_, small);
+    quotient.is_negative_ = quotient_negative;
+    quotient.Trim();
+    remainder.biginteger_.assign(1, small);
+    remainder.size_ = 1;
+    remainder.is_negative_ = remainder_negative;
+    remainder.Trim();
+    return;
+  }
+  BigInt quot;
+  BigInt rem;
+  quot.size_ = dividend.size_ - divisor.size_ + 1;
+  quot.biginteger_.resize(quot.size_);
+  rem.size_ = divisor.size_;
+  rem.biginteger_.resize(rem.size_);
+  DivLimbs(quot.biginteger_.data(), rem.biginteger_.data(),
+           dividend.biginteger_.data(), dividend.size_,
+           divisor.biginteger_.data(), divisor.size_);
+  quot.is_negative_ = quotient_negative;
+  rem.is_negative_ = remainder_negative;
+  quot.Trim();
+  rem.Trim();
+  quotient = std::move(quot);
+  remainder = std::move(rem);
+}
+
+// Lehmer's algorithm for left >= right >= 0. Each pass finds a run of
+// Euclidean steps from the leading 61 bits and applies them in one linear
+// combination over the operands, about 30 bits of progress. Quotients the
+// leading bits cannot settle take a full division step. If right_coef is
+// given it receives c with c * right == gcd modulo left. The cofactors are
+// kept as magnitudes, their signs alternate with every Euclidean step.
+BigInt BigInt::LehmerGcd(BigInt left, BigInt right, BigInt* right_coef) {
+  BigInt left_c;
+  BigInt right_c = 1;
+  bool left_negative = true;
+  BigInt quotient;
+  BigInt remainder;
+  Limb matrix[4];
+  while (right.size_ != 0) {
+    int steps = 0;
+    if (right.size_ >= 2) {
+      int size = left.size_;
+      int shift = 67 - __builtin_clzll(left.biginteger_[size - 1]);
+      auto leading = [size, shift](const BigInt& big) {
+        DoubleLimb window = 0;
+        if (big.size_ == size) {
+          window = static_cast<DoubleLimb>(big.biginteger_[size - 1]) << 64;
+        }
+        if (big.size_ >= size - 1) {
+          window |= big.biginteger_[size - 2];
+        }
+        return static_cast<Limb>(window >> shift);
+      };
+      steps = LehmerMatrix(leading(left), leading(right), matrix);
+    } else if (right_coef == nullptr) {
+      Limb small = right.biginteger_[0];
+      Limb gcd = GcdLimb(small, left.DivSmall(small));
+      left.biginteger_.assign(1, gcd);
+      left.size_ = 1;
+      return left;
+    } else if (left.size_ == 1) {
+      // Only the coefficient of the GCD is needed from the final steps.
+      Limb gcd = left.biginteger_[0];
+      steps = EuclidMatrix(gcd, right.biginteger_[0], matrix);
+      left.biginteger_[0] = gcd;
+      if (steps % 2 != 0) {
+        left_c.Swap(right_c);
+        left_negative = !left_negative;
+      }
+      left_c.MulSmall(matrix[0]);
+      right_c.MulSmall(matrix[1]);
+      left_c += right_c;
+      break;
+    }
+    if (steps == 0) {
+      DivMod(left, right, quotient, remainder);
+      left.Swap(right);
+      right.Swap(remainder);
+      if (right_coef != nullptr) {
+        left_c += quotient * right_c;
+        left_c.Swap(right_c);
+        left_negative = !left_negative;
+      }
+      continue;
+    }
+    int size = left.size_;
+    right.biginteger_.resize(size);
+    right.size_ = size;
+    if (steps % 2 == 0) {
+      LehmerUpdate(left.biginteger_.data(), right.biginteger_.data(), size,
+                   matrix);
+    } else {
+      LehmerUpdate(right.biginteger_.data(), left.biginteger_.data(), size,
+                   matrix);
+      left.Swap(right);
+    }
+    left.Trim();
+    right.Trim();
+    if (right_coef != nullptr) {
+      if (steps % 2 != 0) {
+        left_c.Swap(right_c);
+        left_negative = !left_negative;
+      }
+      int coef_size = std::max(left_c.size_, right_c.size_) + 1;
+      left_c.biginteger_.resize(coef_size);
+      right_c.biginteger_.resize(coef_size);
+      LehmerCofactors(left_c.biginteger_.data(), right_c.biginteger_.data(),
+                      coef_size, matrix);
+      left_c.size_ = coef_size;
+      right_c.size_ = coef_size;
+      left_c.Trim();
+      right_c.Trim();
+    }
+  }
+  if (right_coef != nullptr) {
+    left_c.is_negative_ = left_negative && left_c.size_ != 0;
+    *right_coef = std::move(left_c);
+  }
+  return left;
+}
+
+BigInt BigInt::Gcd(const BigInt& left, const BigInt& right) {
+  if (CompareAbs(left, right) < 0) {
+    return LehmerGcd(Abs(right), Abs(left), nullptr);
+  }
+  return LehmerGcd(Abs(left), Abs(right), nullptr);
+}
+
+BigInt BigInt::ExtendedGcd(const BigInt& left, const BigInt& right,
+                           BigInt& left_coef, BigInt& right_coef) {
+  if (CompareAbs(left, right) < 0) {
+    return ExtendedGcd(right, left, right_coef, left_coef);
+  }
+  if (left.size_ == 0) {
+    left_coef = 0;
+    right_coef = 0;
+    return BigInt();
+  }
+  BigInt right_c;
+  BigInt gcd = LehmerGcd(Abs(left), Abs(right), &right_c);
+  BigInt left_c = gcd - right_c * Abs(right);
+  left_c /= left;
+  if (right.is_negative_) {
+    right_c = -std::move(right_c);
+  }
+  left_coef = std::move(left_c);
+  right_coef = std::move(right_c);
+  return gcd;
+}
+
+bool BigInt::ModInverse(const BigInt& value, const BigInt& modulus,
+                        BigInt& inverse) {
+  BigInt mod = Abs(modulus);
+  BigInt residue = value % mod;
+  if (residue.is_negative_) {
+    residue += mod;
+  }
+  BigInt coef;
+  if (LehmerGcd(mod, std::move(residue), &coef) != 1) {
+    return false;
+  }
+  if (coef.is_negative_) {
+    coef += mod;
+  }
+  inverse = std::move(coef);
+  return true;
+}
+
+// Newton's iteration for the square root with the precision doubling at each
+// step, as in Python's math.isqrt: with c = (BitLength() - 1) / 2, each step
+// takes a from the root of value >> 2 * (c - e) to that of value >> 2 * (c -
+// d) for d close to 2 * e, and only the last step divides at full size. The
+// first 16 to 31 bits of the root come from a word square root.
+void BigInt::Isqrt(const BigInt& value, BigInt& root) {
+  if (&root == &value) {
+    BigInt copy = value;
+    Isqrt(copy, root);
+    return;
+  }
+  if (value.size_ <= 1) {
+    root = value;
+    if (root.size_ != 0) {
+      root.biginteger_[0] = IsqrtLimb(root.biginteger_[0]);
+    }
+    return;
+  }
+  int64_t c = (value.BitLength() - 1) / 2;
+  int step = 59 - __builtin_clzll(c);
+  int64_t d = c >> step;
+  BigInt scratch = value;
+  scratch >>= static_cast<int>(2 * (c - d));
+  root = scratch;
+  root.biginteger_[0] = IsqrtLimb(root.biginteger_[0]);
+  BigInt remainder;
+  for (--step; step >= 0; --step) {
+    int64_t e = d;
+    d = c >> step;
+    scratch = value;
+    scratch >>= static_cast<int>(2 * c - e - d + 1);
+    DivMod(scratch, root, scratch, remainder);
+    root <<= static_cast<int>(d - e - 1);
+    root += scratch;
+  }
+  scratch = root;
+  scratch *= root;
+  if (scratch > value) {
+    --root;
+  }
+}
+
+void BigInt::IRoot(const BigInt& value, int degree, BigInt& root) {
+  if (degree == 2) {
+    Isqrt(value, root);
+    return;
+  }
+  bool negative = value.is_negative_;
+  if (degree == 1 || value.size_ == 0) {
+    root = value;
+    return;
+  }
+  root = RootPart(Abs(value), degree);
+  root.is_negative_ = negative;
+}
+
+// Newton's iteration from above for the degree-th root of value > 0. Roots
+// of up to 40 bits start from a floating point estimate rounded up past its
+// error, longer ones from the root of the leading bits, enough of them that
+// one step leaves an error below 1. The result of that step is confirmed by
+// a power rather than by another division.
+BigInt BigInt::RootPart(const BigInt& value, int degree) {
+  int64_t bits = value.BitLength();
+  if (bits <= 64) {
+    BigInt root;
+    root.AddSmall(IRootLimb(value.biginteger_[0], degree));
+    return root;
+  }
+  if (degree >= bits) {
+    return 1;
+  }
+  int64_t root_bits = (bits - 1) / degree + 1;
+  BigInt root;
+  if (root_bits <= 40) {
+    int64_t shift = bits - 64;
+    Limb top = (value >> static_cast<int>(shift)).biginteger_[0];
+    double log = (std::log2(static_cast<double>(top)) +
+                  static_cast<double>(shift)) /
+                 degree;
+    double margin = std::ldexp(1.0, -21) / degree + std::ldexp(1.0, -45);
+    root.AddSmall(static_cast<Limb>(std::exp2(log) * (1 + margin)) + 1);
+  } else {
+    int64_t half = (root_bits - (32 - __builtin_clz(degree)) - 2) / 2;
+    root = RootPart(value >> static_cast<int>(degree * half), degree);
+    ++root;
+    root <<= static_cast<int>(half);
+  }
+  auto power = [](const BigInt& base, int exponent, BigInt& res) {
+    res = base;
+    for (int bit = 30 - __builtin_clz(exponent); bit >= 0; --bit) {
+      res *= res;
+      if ((exponent >> bit) & 1) {
+        res *= base;
+      }
+    }
+  };
+  BigInt scratch;
+  BigInt quotient;
+  BigInt remainder;
+  while (true) {
+    power(root, degree - 1, scratch);
+    DivMod(value, scratch, quotient, remainder);
+    BigInt next = root;
+    next.MulSmall(degree - 1);
+    next += quotient;
+    next.DivSmall(degree);
+    if (next >= root) {
+      return root;
+    }
+    root.Swap(next);
+    // Every step leaves root at or above the floor of the root.
+    power(root, degree, scratch);
+    if (scratch <= value) {
+      return root;
+    }
+  }
+}
+
+ModularContext::ModularContext(const BigInt& modulus)
+    : modulus_(Abs(modulus)), inverse_(0), montgomery_(false) {
+  reciprocal_ = BigInt::Reciprocal(modulus_);
+  montgomery_ = (modulus_.biginteger_[0] & 1) != 0;
+  if (montgomery_) {
+    // Newton iteration doubles the correct low bits of the inverse each step.
+    Limb low = modulus_.biginteger_[0];
+    Limb inverse = low;
+    for (int i = 0; i < 5; ++i) {
+      inverse *= 2 - low * inverse;
+    }
+    inverse_ = 0 - inverse;
+    BigInt r_squared = 1;
+    r_squared.ShiftLimbs(2 * modulus_.size_);
+    r_squared_ = Reduce(r_squared);
+  }
+}
+
+const BigInt& ModularContext::Modulus() const { return modulus_; }
+
+BigInt ModularContext::Reduce(const BigInt& value) const {
+  BigInt quotient;
+  BigInt remainder;
+  if (!value.is_negative_ && value.size_ <= 2 * modulus_.size_) {
+    BigInt::DivModBarrett(value, modulus_, reciprocal_, quotient, remainder);
+    return remainder;
+  }
+  BigInt::DivMod(value, modulus_, quotient, remainder);
+  if (remainder.is_negative_) {
+    remainder += modulus_;
+  }
+  return remainder;
+}
+
+BigInt ModularContext::MulMod(const BigInt& left, const BigInt& right) const {
+  return Reduce(Reduce(left) * Reduce(right));
+}
+
+// res = left * right in the element representation: Montgomery form for odd
+// moduli, plain residues otherwise. Elements are exactly modulus size limbs
+// and scratch must hold 2 * size + 1 limbs.
+void ModularContext::Multiply(Limb* res, const Limb* left, const Limb* right,
+                              Limb* scratch) const {
+  int size = modulus_.size_;
+  BigInt::MultiplyLimbs(scratch, left, size, right, size);
+  if (montgomery_) {
+    scratch[2 * size] = 0;
+    MontgomeryReduce(scratch, modulus_.biginteger_.data(), size, inverse_,
+                     res);
+    return;
+  }
+  BigInt remainder = Reduce(BigInt::FromLimbs(scratch, 2 * size));
+  std::fill(res, res + size, 0);
+  std::copy(remainder.biginteger_.begin(), remainder.biginteger_.end(), res);
+}
+
+void ModularContext::ToElement(const BigInt& value, Limb* res,
+                               Limb* scratch) const {
+  int size = modulus_.size_;
+  BigInt residue = Reduce(value);
+  std::fill(res, res + size, 0);
+  std::copy(residue.biginteger_.begin(), residue.biginteger_.end(), res);
+  if (montgomery_) {
+    BigInt::Limbs r_squared = r_squared_.biginteger_;
+    r_squared.resize(size);
+    Multiply(res, res, r_squared.data(), scratch);
+  }
+}
+
+BigInt ModularContext::FromElement(const Limb* element, Limb* scratch) const {
+  int size = modulus_.size_;
+  if (montgomery_) {
+    std::fill(scratch, scratch + 2 * size + 1, 0);
+    std::copy(element, element + size, scratch);
+    BigInt::Limbs res;
+    res.resize(size);
+    MontgomeryReduce(scratch, modulus_.biginteger_.data(), size, inverse_,
+                     res.data());
+    return BigInt::FromLimbs(res.data(), size);
+  }
+  return BigInt::FromLimbs(element, size);
+}
+
+// Left-to-right sliding window exponentiation over odd powers of the base.
+BigInt ModularContext::PowMod(const BigInt& base,
+                              const BigInt& exponent) const {
+  int size = modulus_.size_;
+  if (exponent.size_ == 0) {
+    return Reduce(1);
+  }
+  int64_t bits = exponent.BitLength();
+  auto bit = [&exponent](int64_t index) {
+    return (exponent.biginteger_[index / 64] >> (index % 64)) & 1;
+  };
+  int window = WindowBits(bits);
+  BigInt::Limbs scratch;
+  scratch.resize(2 * size + 1);
+  BigInt::Limbs table;
+  table.resize(static_cast<size_t>(size) << (window - 1));
+  ToElement(base, table.data(), scratch.data());
+  BigInt::Limbs square;
+  square.resize(size);
+  Multiply(square.data(), table.data(), table.data(), scratch.data());
+  for (int i = 1; i < (1 << (window - 1)); ++i) {
+    Multiply(table.data() + i * size, table.data() + (i - 1) * size,
+             square.data(), scratch.data());
+  }
+  BigInt::Limbs res;
+  res.resize(size);
+  bool started = false;
+  for (int64_t i = bits - 1; i >= 0;) {
+    if (bit(i) == 0) {
+      Multiply(res.data(), res.data(), res.data(), scratch.data());
+      --i;
+      continue;
+    }
+    int64_t low = std::max<int64_t>(i - window + 1, 0);
+    while (bit(low) == 0) {
+      ++low;
+    }
+    int value = 0;
+    for (int64_t j = i; j >= low; --j) {
+      value = 2 * value + static_cast<int>(bit(j));
+    }
+    const Limb* power = table.data() + (value / 2) * size;
+    if (!started) {
+      std::copy(power, power + size, res.data());
+      started = true;
+    } else {
+      for (int64_t j = i; j >= low; --j) {
+        Multiply(res.data(), res.data(), res.data(), scratch.data());
+      }
+      Multiply(res.data(), res.data(), power, scratch.data());
+    }
+    i = low - 1;
+  }
+  return FromElement(res.data(), scratch.data());
+}
+
+BigInt PowMod(const BigInt& base, const BigInt& exponent,
+              const BigInt& modulus) {
+  return ModularContext(modulus).PowMod(base, exponent);
+}
@@ -1,33 +1,211 @@
 #pragma once
+#include <array>
+#include <charconv>
+#if __cplusplus >= 202002L
+#include <compare>
+#endif
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <vector>
 
 class BigInt {
+ public:
+  using Limb = uint64_t;
+  // Operand sizes in limbs at which operator*= switches algorithms. Products
+  // whose smaller operand reaches parallel_threshold limbs run on threads
+  // threads, 0 meaning std::thread::hardware_concurrency(): the NTT
+  // transforms its three primes concurrently, the other algorithms are split
+  // into independent products. Change these only while no multiplication is
+  // running.
+  struct Tuning {
+    int karatsuba_threshold = 32;
+    int toom3_threshold = 384;
+    int ntt_threshold = 3000;
+    int parallel_threshold = 8192;
+    int threads = 0;
+  };
+
+  class Arena;
+  class ArenaScope;
+
+  // Limb buffer with a std::vector-like interface that keeps up to
+  // kInlineLimbs limbs inside the object and only allocates beyond that.
+  // A buffer belongs to the innermost ArenaScope on the constructing thread,
+  // if any, and takes larger buffers from its arena while that scope is the
+  // innermost one on the arena, from the heap otherwise.
+  class Limbs {
+   public:
+    static const size_t kInlineLimbs = 4;
+    Limbs();
+    Limbs(const Limbs& other);
+    Limbs(Limbs&& other) noexcept;
+    ~Limbs();
+    Limbs& operator=(const Limbs& other);
+    Limbs& operator=(Limbs&& other) noexcept;
+    Limb* data() { return data_; }
+    const Limb* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    Limb& operator[](size_t index) { return data_[index]; }
+    const Limb& operator[](size_t index) const { return data_[index]; }
+    Limb* begin() { return data_; }
+    Limb* end() { return data_ + size_; }
+    const Limb* begin() const { return data_; }
+    const Limb* end() const { return data_ + size_; }
+    void reserve(size_t capacity);
+    void resize(size_t size, Limb value = 0);
+    void assign(const Limb* first, const Limb* last);
+    void assign(size_t count, Limb value);
+    void push_back(Limb value);
+    void pop_back() { --size_; }
+    void clear() { size_ = 0; }
+    void swap(Limbs& other);
+
+   private:
+    Limb* data_;
+    size_t size_;
+    size_t capacity_;
+    ArenaScope* scope_;
+    // data_ came from new[].
+    bool heap_;
+    Limb inline_[kInlineLimbs];
+    bool IsInline() const { return data_ == inline_; }
+    // Whether other's buffer may be handed over to this: heap buffers can
+    // go anywhere, arena ones only stay within the scope that owns them.
+    bool CanTake(const Limbs& other) const;
+    void Take(Limbs& other);
+    void Grow(size_t capacity);
+    void Release();
+  };
+
+  // Bump allocator for limb buffers. Memory is only reclaimed by Reset or
+  // at the end of an ArenaScope, and blocks are kept for reuse.
+  class Arena {
+   public:
+    explicit Arena(size_t block_limbs = 4096);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+    Limb* Allocate(size_t count);
+    void Reset();
+
+   private:
+    friend class ArenaScope;
+    friend class Limbs;
+    struct Block {
+      Limb* data;
+      size_t capacity;
+    };
+    std::vector<Block> blocks_;
+    size_t block_limbs_;
+    size_t block_;
+    size_t used_;
+    // The innermost live scope on this arena.
+    ArenaScope* scope_;
+  };
+
+  // Sums many values with the carries deferred. Each limb is split into two
+  // 32-bit halves added into 64-bit lanes by SSE2, AVX2 or AVX-512 loops
+  // picked at run time, and carries are only propagated by Total. Negative
+  // values go to their own lanes.
+  class Accumulator {
+   public:
+    Accumulator& operator+=(const BigInt& big);
+    Accumulator& operator-=(const BigInt& big);
+    BigInt Total() const;
+    void Clear();
+
+   private:
+    Limbs lanes_[2];
+    uint64_t count_ = 0;
+    void Add(const BigInt& big, bool negative);
+    void Normalize();
+  };
+
+  // While alive, limb buffers constructed on this thread, temporaries of
+  // BigInt arithmetic included, allocate from arena, which is rolled back
+  // when the scope ends. A buffer keeps the scope it was constructed in,
+  // and moving or swapping an arena buffer into a buffer of another scope
+  // copies the limbs. Scopes can nest, on the same arena too: while an
+  // inner scope is alive, buffers of outer scopes grow on the heap. So
+  // BigInts declared outside a scope stay valid, but BigInts constructed
+  // inside it must not outlive it.
+  class ArenaScope {
+   public:
+    explicit ArenaScope(Arena& arena);
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+    ~ArenaScope();
+
+   private:
+    friend class Limbs;
+    Arena& arena_;
+    ArenaScope* previous_;
+    ArenaScope* outer_;
+    size_t block_;
+    size_t used_;
+  };
+
  private:
-  std::vector<int64_t> biginteger_;
+  friend class ModularContext;
+  Limbs biginteger_;
   int size_;
   bool is_negative_;
-  const long long kSystcomp = 1000000000;
-  const int kCellsize = 9;
   void DivisionByTwo();
-  BigInt MinusPart(BigInt left, BigInt bigcopy) const;
-  BigInt Multiply(BigInt multiply, const BigInt& big) const;
-  static bool Zerobool(const BigInt& left, const BigInt& right);
-  static BigInt Check(BigInt big, BigInt left, BigInt ans);
+  void Trim();
+  void AddPart(const BigInt& big);
+  void MinusPart(const BigInt& big, bool big_negative);
+  void AddSmallPart(Limb value, bool negative);
+  template <typename Op>
+  void BitwisePart(const BigInt& big, Op op);
+  void ShiftLimbs(int count);
+  static BigInt FromLimbs(const Limb* limbs, int size);
+  static void MultiplyLimbs(Limb* res, const Limb* left, int left_size,
+                            const Limb* right, int right_size);
+  struct MultiplyPlan;
+  static void PlanMultiply(Limb* res, const Limb* left, int left_size,
+                           const Limb* right, int right_size, int tasks,
+                           MultiplyPlan& plan);
+  static void Toom3(Limb* res, const Limb* left, int left_size,
+                    const Limb* right, int right_size);
+  static BigInt Reciprocal(const BigInt& divisor);
+  static void DivModBarrett(const BigInt& dividend, const BigInt& divisor,
+                            const BigInt& reciprocal, BigInt& quotient,
+                            BigInt& remainder);
+  static BigInt LehmerGcd(BigInt left, BigInt right, BigInt* right_coef);
+  static BigInt RootPart(const BigInt& value, int degree);
+  static BigInt ReadDigits(const char* first, const char* last, int base,
+                           std::vector<BigInt>& powers);
+  static char* WriteDigits(BigInt& value, int level, int base,
+                           const std::vector<BigInt>& powers,
+                           const std::vector<BigInt>& reciprocals,
+                           int64_t width, char* out);
 
  public:
   BigInt();
+  // Decimal with an optional sign, throws std::invalid_argument otherwise.
   BigInt(std::string bigstring);
   BigInt(int64_t intbig);
   BigInt(const BigInt& copy);
-  std::vector<int64_t>& Data();
-  std::vector<int64_t> Data() const;
+  BigInt(BigInt&& other) noexcept;
+  Limbs& Data();
+  const Limbs& Data() const;
   int& Size();
   int Size() const;
   bool& Negative();
   bool Negative() const;
   BigInt& operator=(const BigInt& copy);
+  BigInt& operator=(BigInt&& other) noexcept;
+  // Three-way comparison: negative, zero or positive as *this is less than,
+  // equal to or greater than big. CompareAbs compares magnitudes only.
+  int Compare(const BigInt& big) const;
+  static int CompareAbs(const BigInt& left, const BigInt& right);
+#ifdef __cpp_lib_three_way_comparison
+  std::strong_ordering operator<=>(const BigInt& big) const;
+#endif
   bool operator==(const BigInt& big) const;
   bool operator<(const BigInt& big) const;
   bool operator<=(const BigInt& big) const;
@@ -39,19 +217,502 @@ class BigInt {
   BigInt& operator*=(const BigInt& big);
   BigInt& operator/=(const BigInt& big);
   BigInt& operator%=(const BigInt& big);
-  BigInt operator-() const;
+  // Shifts and bitwise operations act on the infinite two's complement
+  // representation, so >> rounds toward negative infinity. A negative shift
+  // count shifts the other way.
+  BigInt& operator<<=(int shift);
+  BigInt& operator>>=(int shift);
+  BigInt& operator&=(const BigInt& big);
+  BigInt& operator|=(const BigInt& big);
+  BigInt& operator^=(const BigInt& big);
+  // Bit counts of the magnitude, BitLength() is 0 for zero.
+  int64_t PopCount() const;
+  int64_t BitLength() const;
+  BigInt operator-() const&;
+  BigInt operator-() &&;
   BigInt& operator++();
   BigInt operator++(int);
   BigInt& operator--();
   BigInt operator--(int);
+  // In-place operations with a single machine word: MulAdd sets *this to
+  // *this * multiplier + addend, DivSmall truncates like operator/= and
+  // returns the magnitude of the remainder.
+  BigInt& MulAdd(const BigInt& multiplier, Limb addend);
+  BigInt& AddSmall(Limb value);
+  BigInt& MulSmall(Limb value);
+  Limb DivSmall(Limb divisor);
   void Swap(BigInt& big);
+  static Tuning& GetTuning();
+  static void DivMod(const BigInt& dividend, const BigInt& divisor,
+                     BigInt& quotient, BigInt& remainder);
+  // Gcd is non-negative and zero only when both operands are. ExtendedGcd
+  // also sets the Bezout coefficients, left * left_coef + right * right_coef
+  // == gcd. ModInverse sets inverse to the inverse of value modulo a nonzero
+  // modulus, in [0, |modulus|), and returns false if there is none.
+  static BigInt Gcd(const BigInt& left, const BigInt& right);
+  static BigInt ExtendedGcd(const BigInt& left, const BigInt& right,
+                            BigInt& left_coef, BigInt& right_coef);
+  static bool ModInverse(const BigInt& value, const BigInt& modulus,
+                         BigInt& inverse);
+  // Floors of the square root and of the degree-th root, degree >= 1, by
+  // Newton's iteration. value must be non-negative except for odd degrees,
+  // where the root of a negative value is truncated toward zero. root may
+  // alias value.
+  static void Isqrt(const BigInt& value, BigInt& root);
+  static void IRoot(const BigInt& value, int degree, BigInt& root);
+  // Conversions in bases 2 to 36 in the manner of std::from_chars and
+  // std::to_chars. CharsBound(base) is enough room for ToChars. Other bases
+  // make FromChars and ToChars return invalid_argument and CharsBound 0.
+  static std::from_chars_result FromChars(const char* first, const char* last,
+                                          BigInt& value, int base = 10);
+  static std::to_chars_result ToChars(char* first, char* last,
+                                      const BigInt& value, int base = 10);
+  size_t CharsBound(int base = 10) const;
+  template <typename Iterator>
+  static BigInt SumRange(Iterator first, Iterator last);
 };
 
+template <typename Iterator>
+BigInt BigInt::SumRange(Iterator first, Iterator last) {
+  Accumulator sum;
+  for (; first != last; ++first) {
+    sum += *first;
+  }
+  return sum.Total();
+}
+
 BigInt operator*(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator*(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator*(const BigInt& lvalue, BigInt&& rvalue);
+BigInt operator*(BigInt&& lvalue, BigInt&& rvalue);
 BigInt operator+(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator+(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator+(const BigInt& lvalue, BigInt&& rvalue);
+BigInt operator+(BigInt&& lvalue, BigInt&& rvalue);
 BigInt operator/(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator/(BigInt&& lvalue, const BigInt& rvalue);
 BigInt operator-(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator-(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator-(const BigInt& lvalue, BigInt&& rvalue);
+BigInt operator-(BigInt&& lvalue, BigInt&& rvalue);
 BigInt operator%(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator%(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator<<(const BigInt& lvalue, int shift);
+BigInt operator<<(BigInt&& lvalue, int shift);
+BigInt operator>>(const BigInt& lvalue, int shift);
+BigInt operator>>(BigInt&& lvalue, int shift);
+BigInt operator&(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator&(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator|(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator|(BigInt&& lvalue, const BigInt& rvalue);
+BigInt operator^(const BigInt& lvalue, const BigInt& rvalue);
+BigInt operator^(BigInt&& lvalue, const BigInt& rvalue);
 BigInt Abs(const BigInt& big);
+BigInt Abs(BigInt&& big);
+// Streams read and write decimal regardless of the basefield, showbase and
+// uppercase flags; FromChars and ToChars handle other bases.
 std::ostream& operator<<(std::ostream& ostream, const BigInt& big);
-std::istream& operator>>(std::istream& istream, BigInt& big);
\ No newline at end of file
+std::istream& operator>>(std::istream& istream, BigInt& big);
+
+// Arithmetic modulo a fixed positive modulus, set up once and reused. PowMod
+// uses Montgomery multiplication for odd moduli and Barrett reduction for even
+// ones. Results are in [0, modulus), exponents must be non-negative.
+class ModularContext {
+ public:
+  explicit ModularContext(const BigInt& modulus);
+  const BigInt& Modulus() const;
+  BigInt Reduce(const BigInt& value) const;
+  BigInt MulMod(const BigInt& left, const BigInt& right) const;
+  BigInt PowMod(const BigInt& base, const BigInt& exponent) const;
+
+ private:
+  using Limb = BigInt::Limb;
+  BigInt modulus_;
+  BigInt reciprocal_;
+  BigInt r_squared_;
+  Limb inverse_;
+  bool montgomery_;
+  void Multiply(Limb* res, const Limb* left, const Limb* right,
+                Limb* scratch) const;
+  void ToElement(const BigInt& value, Limb* res, Limb* scratch) const;
+  BigInt FromElement(const Limb* element, Limb* scratch) const;
+};
+
+BigInt PowMod(const BigInt& base, const BigInt& exponent,
+              const BigInt& modulus);
+
+// Fixed-width counterpart of BigInt: a Bits-bit two's complement integer in
+// a std::array of limbs. Arithmetic wraps modulo 2^Bits like the built-in
+// integer types, all loops have constant trip counts, and everything except
+// the string, stream and BigInt conversions is constexpr. Division truncates
+// toward zero and >> rounds toward negative infinity, as in BigInt.
+template <int Bits>
+class FixedBigInt {
+  static_assert(Bits > 0 && Bits % 64 == 0,
+                "FixedBigInt width must be a positive multiple of 64");
+
+ public:
+  using Limb = BigInt::Limb;
+  static constexpr int kLimbs = Bits / 64;
+
+  constexpr FixedBigInt() : limbs_() {}
+  constexpr FixedBigInt(int64_t value) : limbs_() {
+    Limb fill = value < 0 ? ~Limb{0} : 0;
+    limbs_[0] = static_cast<Limb>(value);
+    for (int i = 1; i < kLimbs; ++i) {
+      limbs_[i] = fill;
+    }
+  }
+  // The value of big modulo 2^Bits.
+  explicit FixedBigInt(const BigInt& big);
+  explicit FixedBigInt(const std::string& bigstring)
+      : FixedBigInt(BigInt(bigstring)) {}
+  BigInt ToBigInt() const;
+  explicit operator BigInt() const { return ToBigInt(); }
+
+  constexpr std::array<Limb, kLimbs>& Data() { return limbs_; }
+  constexpr const std::array<Limb, kLimbs>& Data() const { return limbs_; }
+  constexpr bool Negative() const { return (limbs_[kLimbs - 1] >> 63) != 0; }
+
+  constexpr int Compare(const FixedBigInt& big) const {
+    if (Negative() != big.Negative()) {
+      return Negative() ? -1 : 1;
+    }
+    for (int i = kLimbs - 1; i >= 0; --i) {
+      if (limbs_[i] != big.limbs_[i]) {
+        return limbs_[i] < big.limbs_[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+  constexpr bool operator==(const FixedBigInt& big) const {
+    for (int i = 0; i < kLimbs; ++i) {
+      if (limbs_[i] != big.limbs_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  constexpr bool operator!=(const FixedBigInt& big) const {
+    return !(*this == big);
+  }
+  constexpr bool operator<(const FixedBigInt& big) const {
+    return Compare(big) < 0;
+  }
+  constexpr bool operator<=(const FixedBigInt& big) const {
+    return Compare(big) <= 0;
+  }
+  constexpr bool operator>(const FixedBigInt& big) const {
+    return Compare(big) > 0;
+  }
+  constexpr bool operator>=(const FixedBigInt& big) const {
+    return Compare(big) >= 0;
+  }
+
+  constexpr FixedBigInt& operator+=(const FixedBigInt& big) {
+    Limb carry = 0;
+    for (int i = 0; i < kLimbs; ++i) {
+      Limb sum = limbs_[i] + carry;
+      carry = static_cast<Limb>(sum < carry);
+      limbs_[i] = sum + big.limbs_[i];
+      carry += static_cast<Limb>(limbs_[i] < sum);
+    }
+    return *this;
+  }
+  constexpr FixedBigInt& operator-=(const FixedBigInt& big) {
+    Limb borrow = 0;
+    for (int i = 0; i < kLimbs; ++i) {
+      Limb diff = limbs_[i] - big.limbs_[i];
+      Limb next = static_cast<Limb>(limbs_[i] < big.limbs_[i]);
+      next += static_cast<Limb>(diff < borrow);
+      limbs_[i] = diff - borrow;
+      borrow = next;
+    }
+    return *this;
+  }
+  // Schoolbook product of the low kLimbs limbs, the rest wraps away.
+  constexpr FixedBigInt& operator*=(const FixedBigInt& big) {
+    std::array<Limb, kLimbs> res{};
+    for (int i = 0; i < kLimbs; ++i) {
+      Limb carry = 0;
+      for (int j = 0; i + j < kLimbs; ++j) {
+        unsigned __int128 cur =
+            static_cast<unsigned __int128>(limbs_[i]) * big.limbs_[j] +
+            res[i + j] + carry;
+        res[i + j] = static_cast<Limb>(cur);
+        carry = static_cast<Limb>(cur >> 64);
+      }
+    }
+    limbs_ = res;
+    return *this;
+  }
+  constexpr FixedBigInt& operator/=(const FixedBigInt& big) {
+    FixedBigInt remainder;
+    DivMod(*this, big, *this, remainder);
+    return *this;
+  }
+  constexpr FixedBigInt& operator%=(const FixedBigInt& big) {
+    FixedBigInt quotient;
+    DivMod(*this, big, quotient, *this);
+    return *this;
+  }
+  constexpr FixedBigInt& operator&=(const FixedBigInt& big) {
+    for (int i = 0; i < kLimbs; ++i) {
+      limbs_[i] &= big.limbs_[i];
+    }
+    return *this;
+  }
+  constexpr FixedBigInt& operator|=(const FixedBigInt& big) {
+    for (int i = 0; i < kLimbs; ++i) {
+      limbs_[i] |= big.limbs_[i];
+    }
+    return *this;
+  }
+  constexpr FixedBigInt& operator^=(const FixedBigInt& big) {
+    for (int i = 0; i < kLimbs; ++i) {
+      limbs_[i] ^= big.limbs_[i];
+    }
+    return *this;
+  }
+  constexpr FixedBigInt& operator<<=(int shift) {
+    if (shift < 0) {
+      return *this >>= -shift;
+    }
+    int limbs = shift / 64;
+    int bits = shift % 64;
+    for (int i = kLimbs - 1; i >= 0; --i) {
+      Limb cur = i >= limbs ? limbs_[i - limbs] << bits : 0;
+      if (bits != 0 && i > limbs) {
+        cur |= limbs_[i - limbs - 1] >> (64 - bits);
+      }
+      limbs_[i] = cur;
+    }
+    return *this;
+  }
+  constexpr FixedBigInt& operator>>=(int shift) {
+    if (shift < 0) {
+      return *this <<= -shift;
+    }
+    Limb fill = Negative() ? ~Limb{0} : 0;
+    int limbs = shift / 64;
+    int bits = shift % 64;
+    for (int i = 0; i < kLimbs; ++i) {
+      Limb low = i + limbs < kLimbs ? limbs_[i + limbs] : fill;
+      Limb high = i + limbs + 1 < kLimbs ? limbs_[i + limbs + 1] : fill;
+      limbs_[i] = bits == 0 ? low : (low >> bits) | (high << (64 - bits));
+    }
+    return *this;
+  }
+
+  constexpr FixedBigInt operator-() const {
+    FixedBigInt res;
+    res -= *this;
+    return res;
+  }
+  constexpr FixedBigInt operator~() const {
+    FixedBigInt res = *this;
+    for (int i = 0; i < kLimbs; ++i) {
+      res.limbs_[i] = ~res.limbs_[i];
+    }
+    return res;
+  }
+  constexpr FixedBigInt& operator++() { return *this += 1; }
+  constexpr FixedBigInt operator++(int) {
+    FixedBigInt old = *this;
+    *this += 1;
+    return old;
+  }
+  constexpr FixedBigInt& operator--() { return *this -= 1; }
+  constexpr FixedBigInt operator--(int) {
+    FixedBigInt old = *this;
+    *this -= 1;
+    return old;
+  }
+
+  friend constexpr FixedBigInt operator+(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue += rvalue;
+  }
+  friend constexpr FixedBigInt operator-(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue -= rvalue;
+  }
+  friend constexpr FixedBigInt operator*(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue *= rvalue;
+  }
+  friend constexpr FixedBigInt operator/(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue /= rvalue;
+  }
+  friend constexpr FixedBigInt operator%(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue %= rvalue;
+  }
+  friend constexpr FixedBigInt operator&(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue &= rvalue;
+  }
+  friend constexpr FixedBigInt operator|(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue |= rvalue;
+  }
+  friend constexpr FixedBigInt operator^(FixedBigInt lvalue,
+                                         const FixedBigInt& rvalue) {
+    return lvalue ^= rvalue;
+  }
+  friend constexpr FixedBigInt operator<<(FixedBigInt lvalue, int shift) {
+    return lvalue <<= shift;
+  }
+  friend constexpr FixedBigInt operator>>(FixedBigInt lvalue, int shift) {
+    return lvalue >>= shift;
+  }
+
+  // Truncating division with the remainder taking the dividend's sign.
+  // quotient and remainder may alias the operands.
+  static constexpr void DivMod(const FixedBigInt& dividend,
+                               const FixedBigInt& divisor,
+                               FixedBigInt& quotient, FixedBigInt& remainder) {
+    bool quotient_negative = dividend.Negative() != divisor.Negative();
+    bool remainder_negative = dividend.Negative();
+    FixedBigInt num = dividend.Negative() ? -dividend : dividend;
+    FixedBigInt den = divisor.Negative() ? -divisor : divisor;
+    DivModMagnitude(num.limbs_, den.limbs_, quotient.limbs_,
+                    remainder.limbs_);
+    if (quotient_negative) {
+      quotient = -quotient;
+    }
+    if (remainder_negative) {
+      remainder = -remainder;
+    }
+  }
+
+ private:
+  std::array<Limb, kLimbs> limbs_;
+
+  // Unsigned Knuth division, den must be nonzero and quot / rem distinct
+  // from num and den.
+  static constexpr void DivModMagnitude(const std::array<Limb, kLimbs>& num,
+                                        const std::array<Limb, kLimbs>& den,
+                                        std::array<Limb, kLimbs>& quot,
+                                        std::array<Limb, kLimbs>& rem) {
+    using DoubleLimb = unsigned __int128;
+    int den_size = kLimbs;
+    while (den[den_size - 1] == 0) {
+      --den_size;
+    }
+    quot = {};
+    rem = {};
+    if (den_size == 1) {
+      DoubleLimb cur = 0;
+      for (int i = kLimbs - 1; i >= 0; --i) {
+        cur = (cur << 64) | num[i];
+        quot[i] = static_cast<Limb>(cur / den[0]);
+        cur %= den[0];
+      }
+      rem[0] = static_cast<Limb>(cur);
+      return;
+    }
+    if constexpr (kLimbs > 1) {
+      int shift = __builtin_clzll(den[den_size - 1]);
+      std::array<Limb, kLimbs + 1> norm_num{};
+      std::array<Limb, kLimbs> norm_den{};
+      for (int i = kLimbs; i >= 0; --i) {
+        Limb high = i < kLimbs ? num[i] << shift : 0;
+        Limb low = i > 0 && shift != 0 ? num[i - 1] >> (64 - shift) : 0;
+        norm_num[i] = high | low;
+      }
+      for (int i = den_size - 1; i >= 0; --i) {
+        Limb low = i > 0 && shift != 0 ? den[i - 1] >> (64 - shift) : 0;
+        norm_den[i] = (den[i] << shift) | low;
+      }
+      Limb top = norm_den[den_size - 1];
+      Limb next = norm_den[den_size - 2];
+      for (int j = kLimbs - den_size; j >= 0; --j) {
+        DoubleLimb head =
+            (static_cast<DoubleLimb>(norm_num[j + den_size]) << 64) |
+            norm_num[j + den_size - 1];
+        DoubleLimb quot_hat = head / top;
+        DoubleLimb rem_hat = head % top;
+        while ((quot_hat >> 64) != 0 ||
+               quot_hat * next >
+                   ((rem_hat << 64) | norm_num[j + den_size - 2])) {
+          --quot_hat;
+          rem_hat += top;
+          if ((rem_hat >> 64) != 0) {
+            break;
+          }
+        }
+        Limb carry = 0;
+        Limb borrow = 0;
+        for (int i = 0; i < den_size; ++i) {
+          DoubleLimb product = quot_hat * norm_den[i] + carry;
+          carry = static_cast<Limb>(product >> 64);
+          Limb sub = static_cast<Limb>(product);
+          Limb cur = norm_num[i + j];
+          Limb diff = cur - sub;
+          Limb next_borrow = static_cast<Limb>(cur < sub);
+          next_borrow += static_cast<Limb>(diff < borrow);
+          norm_num[i + j] = diff - borrow;
+          borrow = next_borrow;
+        }
+        Limb high = norm_num[j + den_size];
+        norm_num[j + den_size] = high - carry - borrow;
+        if (high < carry || high - carry < borrow) {
+          --quot_hat;
+          Limb add_carry = 0;
+          for (int i = 0; i < den_size; ++i) {
+            DoubleLimb sum = static_cast<DoubleLimb>(norm_num[i + j]) +
+                             norm_den[i] + add_carry;
+            norm_num[i + j] = static_cast<Limb>(sum);
+            add_carry = static_cast<Limb>(sum >> 64);
+          }
+          norm_num[j + den_size] += add_carry;
+        }
+        quot[j] = static_cast<Limb>(quot_hat);
+      }
+      for (int i = 0; i < den_size; ++i) {
+        Limb high = shift != 0 ? norm_num[i + 1] << (64 - shift) : 0;
+        rem[i] = (norm_num[i] >> shift) | high;
+      }
+    }
+  }
+};
+
+template <int Bits>
+FixedBigInt<Bits>::FixedBigInt(const BigInt& big) : limbs_() {
+  for (int i = 0; i < kLimbs && i < big.Size(); ++i) {
+    limbs_[i] = big.Data()[i];
+  }
+  if (big.Negative()) {
+    *this = -*this;
+  }
+}
+
+template <int Bits>
+BigInt FixedBigInt<Bits>::ToBigInt() const {
+  FixedBigInt magnitude = Negative() ? -*this : *this;
+  int size = kLimbs;
+  while (size > 0 && magnitude.limbs_[size - 1] == 0) {
+    --size;
+  }
+  BigInt big;
+  big.Data().assign(magnitude.limbs_.data(), magnitude.limbs_.data() + size);
+  big.Size() = size;
+  big.Negative() = Negative() && size != 0;
+  return big;
+}
+
+template <int Bits>
+std::ostream& operator<<(std::ostream& ostream, const FixedBigInt<Bits>& big) {
+  return ostream << big.ToBigInt();
+}
+
+template <int Bits>
+std::istream& operator>>(std::istream& istream, FixedBigInt<Bits>& big) {
+  BigInt value;
+  if (istream >> value) {
+    big = FixedBigInt<Bits>(value);
+  }
+  return istream;
+}
@@ -0,0 +1,559 @@
+#include "big_integer.hpp"
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Up to limbs random limbs with a random sign, zero included.
+BigInt Random(std::mt19937_64& gen, int limbs) {
+  BigInt big;
+  int size = static_cast<int>(gen() % (limbs + 1));
+  big.Data().resize(size);
+  for (int i = 0; i < size; ++i) {
+    big.Data()[i] = gen();
+  }
+  big.Size() = size;
+  while (big.Size() > 0 && big.Data()[big.Size() - 1] == 0) {
+    --big.Size();
+  }
+  big.Negative() = big.Size() != 0 && gen() % 2 == 0;
+  return big;
+}
+
+// Restoring binary long division, one bit at a time, with the quotient
+// truncated toward zero and the remainder taking the sign of the dividend.
+void ReferenceDivMod(const BigInt& dividend, const BigInt& divisor,
+                     BigInt& quotient, BigInt& remainder) {
+  BigInt num = Abs(dividend);
+  BigInt den = Abs(divisor);
+  quotient = 0;
+  remainder = 0;
+  for (int64_t bit = num.BitLength() - 1; bit >= 0; --bit) {
+    remainder <<= 1;
+    remainder += (num >> static_cast<int>(bit)) & 1;
+    quotient <<= 1;
+    if (remainder >= den) {
+      remainder -= den;
+      ++quotient;
+    }
+  }
+  if (dividend.Negative() != divisor.Negative()) {
+    quotient = -quotient;
+  }
+  if (dividend.Negative()) {
+    remainder = -remainder;
+  }
+}
+
+const char kDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// Horner's rule on a digit string of the given base with an optional sign.
+BigInt ReferenceParse(const std::string& digits, int base) {
+  BigInt value;
+  size_t start = digits[0] == '-' || digits[0] == '+' ? 1 : 0;
+  for (size_t i = start; i < digits.size(); ++i) {
+    int digit = static_cast<int>(
+        std::string(kDigits).find(static_cast<char>(std::tolower(digits[i]))));
+    value = value * base + digit;
+  }
+  return digits[0] == '-' ? -value : value;
+}
+
+// Digits by repeated division by the base, least significant first.
+std::string ReferencePrint(BigInt value, int base) {
+  if (value == 0) {
+    return "0";
+  }
+  bool negative = value.Negative();
+  value = Abs(value);
+  std::string digits;
+  while (value != 0) {
+    digits += kDigits[value.DivSmall(base)];
+  }
+  if (negative) {
+    digits += '-';
+  }
+  return std::string(digits.rbegin(), digits.rend());
+}
+
+std::string RandomDigits(std::mt19937_64& gen, int length, int base) {
+  std::string digits;
+  if (gen() % 3 == 0) {
+    digits += gen() % 2 == 0 ? '-' : '+';
+  }
+  for (int i = 0; i < length; ++i) {
+    char digit = kDigits[gen() % base];
+    digits += gen() % 2 == 0 ? static_cast<char>(std::toupper(digit)) : digit;
+  }
+  return digits;
+}
+
+// Remainder in [0, |modulus|).
+BigInt ReferenceMod(const BigInt& value, const BigInt& modulus) {
+  BigInt res = value % modulus;
+  return res.Negative() ? res + Abs(modulus) : res;
+}
+
+// Right-to-left square and multiply with a full reduction after each step.
+BigInt ReferencePowMod(BigInt base, const BigInt& exponent,
+                       const BigInt& modulus) {
+  BigInt res = ReferenceMod(1, modulus);
+  base = ReferenceMod(base, modulus);
+  for (int64_t bit = 0; bit < exponent.BitLength(); ++bit) {
+    if (((exponent >> static_cast<int>(bit)) & 1) != 0) {
+      res = ReferenceMod(res * base, modulus);
+    }
+    base = ReferenceMod(base * base, modulus);
+  }
+  return res;
+}
+
+// Euclid's algorithm with full divisions.
+BigInt ReferenceGcd(BigInt left, BigInt right) {
+  left = Abs(left);
+  right = Abs(right);
+  while (right != 0) {
+    left %= right;
+    left.Swap(right);
+  }
+  return left;
+}
+
+BigInt Power(const BigInt& base, int degree) {
+  BigInt res = 1;
+  for (int i = 0; i < degree; ++i) {
+    res *= base;
+  }
+  return res;
+}
+
+// Sets the root bit by bit from the top, truncating toward zero.
+BigInt ReferenceRoot(const BigInt& value, int degree) {
+  BigInt magnitude = Abs(value);
+  BigInt root;
+  for (int64_t bit = magnitude.BitLength() / degree; bit >= 0; --bit) {
+    BigInt candidate = root | (BigInt(1) << static_cast<int>(bit));
+    if (Power(candidate, degree) <= magnitude) {
+      root = candidate;
+    }
+  }
+  return value.Negative() ? -root : root;
+}
+
+constexpr FixedBigInt<128> Factorial(int n) {
+  FixedBigInt<128> res = 1;
+  for (int i = 2; i <= n; ++i) {
+    res *= i;
+  }
+  return res;
+}
+
+}  // namespace
+
+TEST(Division, MatchesLongDivision) {
+  std::mt19937_64 gen(3);
+  for (int i = 0; i < 3000; ++i) {
+    BigInt dividend = Random(gen, 12);
+    BigInt divisor = Random(gen, 1 + static_cast<int>(gen() % 8));
+    if (divisor == 0) {
+      continue;
+    }
+    BigInt quotient;
+    BigInt remainder;
+    BigInt expected_quotient;
+    BigInt expected_remainder;
+    BigInt::DivMod(dividend, divisor, quotient, remainder);
+    ReferenceDivMod(dividend, divisor, expected_quotient, expected_remainder);
+    ASSERT_EQ(quotient, expected_quotient);
+    ASSERT_EQ(remainder, expected_remainder);
+    ASSERT_EQ(dividend / divisor, expected_quotient);
+    ASSERT_EQ(dividend % divisor, expected_remainder);
+  }
+}
+
+// Divisors whose top limbs make the quotient estimate overshoot, and
+// dividends equal to, just below and just above a multiple.
+TEST(Division, EdgeOperands) {
+  BigInt limb = (BigInt(1) << 64) - 1;
+  std::vector<BigInt> values = {0,
+                                1,
+                                -1,
+                                limb,
+                                -limb,
+                                BigInt(1) << 64,
+                                (BigInt(1) << 128) - 1,
+                                (BigInt(1) << 191) + 1,
+                                -((BigInt(1) << 256) - (BigInt(1) << 128)),
+                                limb * limb * limb};
+  for (const BigInt& dividend : values) {
+    for (const BigInt& divisor : values) {
+      if (divisor == 0) {
+        continue;
+      }
+      for (int delta = -1; delta <= 1; ++delta) {
+        BigInt num = dividend * divisor + delta;
+        BigInt quotient;
+        BigInt remainder;
+        BigInt expected_quotient;
+        BigInt expected_remainder;
+        BigInt::DivMod(num, divisor, quotient, remainder);
+        ReferenceDivMod(num, divisor, expected_quotient, expected_remainder);
+        ASSERT_EQ(quotient, expected_quotient);
+        ASSERT_EQ(remainder, expected_remainder);
+      }
+    }
+  }
+}
+
+TEST(Division, NoNegativeZero) {
+  BigInt quotient;
+  BigInt remainder;
+  BigInt::DivMod(BigInt(-5), BigInt(7), quotient, remainder);
+  ASSERT_FALSE(quotient.Negative());
+  BigInt::DivMod(-(BigInt(1) << 130), BigInt(1) << 65, quotient, remainder);
+  ASSERT_FALSE(remainder.Negative());
+  ASSERT_EQ(quotient, -(BigInt(1) << 65));
+}
+
+TEST(Division, Aliasing) {
+  std::mt19937_64 gen(4);
+  for (int i = 0; i < 500; ++i) {
+    BigInt dividend = Random(gen, 6);
+    BigInt divisor = Random(gen, 1 + static_cast<int>(gen() % 4));
+    if (divisor == 0) {
+      continue;
+    }
+    BigInt expected_quotient;
+    BigInt expected_remainder;
+    ReferenceDivMod(dividend, divisor, expected_quotient, expected_remainder);
+    BigInt left = dividend;
+    BigInt right = divisor;
+    BigInt::DivMod(left, right, left, right);
+    ASSERT_EQ(left, expected_quotient);
+    ASSERT_EQ(right, expected_remainder);
+    left = dividend;
+    right = divisor;
+    BigInt::DivMod(left, right, right, left);
+    ASSERT_EQ(right, expected_quotient);
+    ASSERT_EQ(left, expected_remainder);
+    BigInt self = divisor;
+    BigInt::DivMod(self, self, self, left);
+    ASSERT_EQ(self, 1);
+    ASSERT_EQ(left, 0);
+  }
+}
+
+// Lengths reach the divide and conquer and Barrett paths of both directions.
+TEST(Chars, MatchesHorner) {
+  std::mt19937_64 gen(5);
+  for (int length : {1, 5, 19, 20, 100, 700, 3000, 6000}) {
+    for (int base = 2; base <= 36; ++base) {
+      std::string digits = RandomDigits(gen, length, base);
+      BigInt value;
+      const char* last = digits.data() + digits.size();
+      std::from_chars_result res =
+          BigInt::FromChars(digits.data(), last, value, base);
+      ASSERT_EQ(res.ec, std::errc());
+      ASSERT_EQ(res.ptr, last);
+      BigInt expected = ReferenceParse(digits, base);
+      ASSERT_EQ(value, expected);
+      std::string printed(value.CharsBound(base), '\0');
+      std::to_chars_result out = BigInt::ToChars(
+          printed.data(), printed.data() + printed.size(), value, base);
+      ASSERT_EQ(out.ec, std::errc());
+      printed.resize(out.ptr - printed.data());
+      ASSERT_EQ(printed, ReferencePrint(expected, base));
+    }
+  }
+}
+
+TEST(Chars, Parsing) {
+  BigInt value = 42;
+  std::string text = "-0";
+  ASSERT_EQ(BigInt::FromChars(text.data(), text.data() + 2, value).ec,
+            std::errc());
+  ASSERT_EQ(value, 0);
+  ASSERT_FALSE(value.Negative());
+  text = "000123xyz";
+  std::from_chars_result res =
+      BigInt::FromChars(text.data(), text.data() + text.size(), value);
+  ASSERT_EQ(res.ptr, text.data() + 6);
+  ASSERT_EQ(value, 123);
+  for (std::string bad : {"", "-", "+", "x1", "--1", " 1"}) {
+    value = 42;
+    res = BigInt::FromChars(bad.data(), bad.data() + bad.size(), value);
+    ASSERT_EQ(res.ec, std::errc::invalid_argument);
+    ASSERT_EQ(res.ptr, bad.data());
+    ASSERT_EQ(value, 42);
+  }
+  text = "1";
+  for (int base : {-1, 0, 1, 37}) {
+    res = BigInt::FromChars(text.data(), text.data() + 1, value, base);
+    ASSERT_EQ(res.ec, std::errc::invalid_argument);
+    ASSERT_EQ(value.CharsBound(base), 0);
+  }
+}
+
+TEST(Chars, Printing) {
+  BigInt value = -(BigInt(1) << 200);
+  std::string expected = ReferencePrint(value, 10);
+  std::string buffer(expected.size() - 1, '\0');
+  std::to_chars_result res = BigInt::ToChars(
+      buffer.data(), buffer.data() + buffer.size(), value);
+  ASSERT_EQ(res.ec, std::errc::value_too_large);
+  buffer.resize(expected.size());
+  res = BigInt::ToChars(buffer.data(), buffer.data() + buffer.size(), value);
+  ASSERT_EQ(res.ec, std::errc());
+  ASSERT_EQ(buffer, expected);
+  res = BigInt::ToChars(buffer.data(), buffer.data() + buffer.size(), value,
+                        37);
+  ASSERT_EQ(res.ec, std::errc::invalid_argument);
+  std::ostringstream stream;
+  stream << std::hex << std::showbase << value;
+  ASSERT_EQ(stream.str(), expected);
+}
+
+// Odd moduli take the Montgomery path, even ones Barrett reduction.
+TEST(ModularContext, PowModMatchesSquareAndMultiply) {
+  std::mt19937_64 gen(6);
+  for (int i = 0; i < 400; ++i) {
+    BigInt modulus = Random(gen, 1 + static_cast<int>(gen() % 9));
+    if (modulus == 0) {
+      continue;
+    }
+    if (i % 2 == 0) {
+      modulus |= 1;
+    }
+    ModularContext context(modulus);
+    ASSERT_EQ(context.Modulus(), Abs(modulus));
+    BigInt base = Random(gen, 12);
+    BigInt exponent = Abs(Random(gen, 2));
+    BigInt expected = ReferencePowMod(base, exponent, modulus);
+    ASSERT_EQ(context.PowMod(base, exponent), expected);
+    ASSERT_EQ(PowMod(base, exponent, modulus), expected);
+    BigInt other = Random(gen, 12);
+    ASSERT_EQ(context.Reduce(base), ReferenceMod(base, modulus));
+    ASSERT_EQ(context.MulMod(base, other),
+              ReferenceMod(base * other, modulus));
+  }
+}
+
+TEST(ModularContext, EdgeOperands) {
+  BigInt prime = (BigInt(1) << 127) - 1;
+  ModularContext context(prime);
+  ASSERT_EQ(context.PowMod(0, 0), 1);
+  ASSERT_EQ(context.PowMod(0, 5), 0);
+  ASSERT_EQ(context.PowMod(prime, 3), 0);
+  ASSERT_EQ(context.PowMod(-1, 3), prime - 1);
+  ASSERT_EQ(context.PowMod(-1, 4), 1);
+  // Fermat: a^(p - 1) = 1 for a not divisible by p.
+  ASSERT_EQ(context.PowMod(BigInt(1) << 200, prime - 1), 1);
+  ASSERT_EQ(ModularContext(1).PowMod(7, 0), 0);
+  ASSERT_EQ(ModularContext(1).PowMod(7, 9), 0);
+  ASSERT_EQ(ModularContext(-10).PowMod(-3, 3), 3);
+  BigInt even = BigInt(1) << 256;
+  ASSERT_EQ(ModularContext(even).PowMod(3, even),
+            ReferencePowMod(3, even, even));
+  ASSERT_EQ(ModularContext(even).PowMod(2, 256), 0);
+}
+
+// Shared factors make the gcd nontrivial, long operands go through Lehmer's
+// steps.
+TEST(Gcd, MatchesEuclid) {
+  std::mt19937_64 gen(7);
+  for (int i = 0; i < 1000; ++i) {
+    BigInt factor = Random(gen, static_cast<int>(gen() % 3));
+    BigInt left = Random(gen, 40) * factor;
+    BigInt right = Random(gen, 1 + static_cast<int>(gen() % 40)) * factor;
+    BigInt expected = ReferenceGcd(left, right);
+    ASSERT_EQ(BigInt::Gcd(left, right), expected);
+    BigInt left_coef;
+    BigInt right_coef;
+    ASSERT_EQ(BigInt::ExtendedGcd(left, right, left_coef, right_coef),
+              expected);
+    ASSERT_EQ(left * left_coef + right * right_coef, expected);
+  }
+}
+
+TEST(Gcd, EdgeOperands) {
+  BigInt big = (BigInt(1) << 300) + 7;
+  ASSERT_EQ(BigInt::Gcd(0, 0), 0);
+  ASSERT_EQ(BigInt::Gcd(0, -big), big);
+  ASSERT_EQ(BigInt::Gcd(-big, 0), big);
+  ASSERT_EQ(BigInt::Gcd(-big, -big), big);
+  ASSERT_EQ(BigInt::Gcd(big, 1), 1);
+  ASSERT_EQ(BigInt::Gcd(BigInt(1) << 200, BigInt(3) << 130),
+            BigInt(1) << 130);
+  BigInt left_coef;
+  BigInt right_coef;
+  ASSERT_EQ(BigInt::ExtendedGcd(0, 0, left_coef, right_coef), 0);
+  ASSERT_EQ(BigInt::ExtendedGcd(0, -big, left_coef, right_coef), big);
+  ASSERT_EQ(-big * right_coef, big);
+  ASSERT_EQ(BigInt::ExtendedGcd(-big, big, left_coef, right_coef), big);
+  ASSERT_EQ(-big * left_coef + big * right_coef, big);
+}
+
+TEST(Gcd, ModInverse) {
+  std::mt19937_64 gen(8);
+  for (int i = 0; i < 1000; ++i) {
+    BigInt modulus = Random(gen, 1 + static_cast<int>(gen() % 6));
+    if (modulus == 0) {
+      continue;
+    }
+    BigInt value = Random(gen, 8);
+    BigInt inverse = 42;
+    bool exists = BigInt::ModInverse(value, modulus, inverse);
+    ASSERT_EQ(exists, ReferenceGcd(value, modulus) == 1);
+    if (exists) {
+      ASSERT_FALSE(inverse.Negative());
+      ASSERT_LT(inverse, Abs(modulus));
+      ASSERT_EQ(ReferenceMod(value * inverse, modulus),
+                ReferenceMod(1, modulus));
+    }
+  }
+  // Against an exhaustive search over a small modulus.
+  for (int modulus = 1; modulus <= 30; ++modulus) {
+    for (int value = -40; value <= 40; ++value) {
+      int expected = -1;
+      for (int candidate = 0; candidate < modulus; ++candidate) {
+        if (((value * candidate) % modulus + modulus) % modulus ==
+            1 % modulus) {
+          expected = candidate;
+          break;
+        }
+      }
+      BigInt inverse;
+      ASSERT_EQ(BigInt::ModInverse(value, modulus, inverse), expected >= 0);
+      if (expected >= 0) {
+        ASSERT_EQ(inverse, expected);
+      }
+    }
+  }
+}
+
+TEST(Roots, MatchBitByBit) {
+  std::mt19937_64 gen(9);
+  for (int i = 0; i < 600; ++i) {
+    BigInt value = Abs(Random(gen, 1 + static_cast<int>(gen() % 20)));
+    int degree = 1 + static_cast<int>(gen() % 7);
+    BigInt root;
+    BigInt::Isqrt(value, root);
+    ASSERT_EQ(root, ReferenceRoot(value, 2));
+    BigInt::IRoot(value, degree, root);
+    ASSERT_EQ(root, ReferenceRoot(value, degree));
+    if (degree % 2 == 1) {
+      BigInt::IRoot(-value, degree, root);
+      ASSERT_EQ(root, ReferenceRoot(-value, degree));
+    }
+  }
+}
+
+// Perfect powers and their neighbours, where an off by one shows.
+TEST(Roots, PerfectPowers) {
+  std::mt19937_64 gen(10);
+  for (int degree = 1; degree <= 9; ++degree) {
+    for (int i = 0; i < 30; ++i) {
+      BigInt base = Abs(Random(gen, 1 + static_cast<int>(gen() % 5)));
+      BigInt power = Power(base, degree);
+      for (int delta = -1; delta <= 1; ++delta) {
+        BigInt value = power + delta;
+        if (value.Negative()) {
+          continue;
+        }
+        BigInt root;
+        BigInt::IRoot(value, degree, root);
+        ASSERT_EQ(root, ReferenceRoot(value, degree));
+        if (delta == 0) {
+          ASSERT_EQ(root, base);
+        }
+      }
+    }
+  }
+  BigInt root = 5;
+  BigInt::Isqrt(0, root);
+  ASSERT_EQ(root, 0);
+  BigInt::IRoot(-1, 3, root);
+  ASSERT_EQ(root, -1);
+  BigInt::IRoot(-26, 3, root);
+  ASSERT_EQ(root, -2);
+  BigInt::IRoot(BigInt(1) << 600, 600, root);
+  ASSERT_EQ(root, 2);
+  BigInt::IRoot((BigInt(1) << 600) - 1, 600, root);
+  ASSERT_EQ(root, 1);
+}
+
+TEST(Roots, RootAliasesValue) {
+  std::mt19937_64 gen(11);
+  for (int i = 0; i < 200; ++i) {
+    BigInt value = Abs(Random(gen, 12));
+    BigInt self = value;
+    BigInt::Isqrt(self, self);
+    ASSERT_EQ(self, ReferenceRoot(value, 2));
+    self = -value;
+    BigInt::IRoot(self, 5, self);
+    ASSERT_EQ(self, ReferenceRoot(-value, 5));
+  }
+}
+
+// Checked by the compiler, so a FixedBigInt operation that stops being
+// constexpr breaks the build.
+static_assert(Factorial(20) / Factorial(18) == 380);
+static_assert(Factorial(20) % Factorial(18) == 0);
+static_assert(Factorial(25) / Factorial(23) == 600);
+static_assert(Factorial(25) % (Factorial(23) + 1) == Factorial(23) - 599);
+static_assert(FixedBigInt<128>(-7) / 2 == -3);
+static_assert(FixedBigInt<128>(-7) % 2 == -1);
+static_assert(FixedBigInt<128>(7) / -2 == -3);
+static_assert(FixedBigInt<128>(7) % -2 == 1);
+static_assert(FixedBigInt<128>(-7) / -2 == 3);
+static_assert(FixedBigInt<128>(-7) % -2 == -1);
+static_assert(-Factorial(25) / Factorial(20) == -6375600);
+static_assert((FixedBigInt<128>(-7) >> 1) == -4);
+static_assert((FixedBigInt<128>(1) << 127) < 0);
+static_assert((FixedBigInt<128>(1) << 128) == 0);
+
+TEST(FixedBigInt, MatchesBigIntModuloWidth) {
+  std::mt19937_64 gen(1);
+  for (int i = 0; i < 2000; ++i) {
+    BigInt left = Random(gen, 5);
+    BigInt right = Random(gen, 5);
+    FixedBigInt<256> fixed_left(left);
+    FixedBigInt<256> fixed_right(right);
+    ASSERT_EQ(FixedBigInt<256>(left + right), fixed_left + fixed_right);
+    ASSERT_EQ(FixedBigInt<256>(left - right), fixed_left - fixed_right);
+    ASSERT_EQ(FixedBigInt<256>(left * right), fixed_left * fixed_right);
+    ASSERT_EQ(FixedBigInt<256>(left & right), fixed_left & fixed_right);
+    ASSERT_EQ(FixedBigInt<256>(left << 70), fixed_left << 70);
+  }
+}
+
+TEST(FixedBigInt, DivisionTruncates) {
+  std::mt19937_64 gen(2);
+  for (int i = 0; i < 2000; ++i) {
+    // Below 2^255 in magnitude, so both fit and the quotient cannot wrap.
+    BigInt left = Random(gen, 4) >> 2;
+    BigInt right = Random(gen, 4) >> static_cast<int>(gen() % 250);
+    if (right == 0) {
+      right = -3;
+    }
+    FixedBigInt<256> quotient(left);
+    quotient /= FixedBigInt<256>(right);
+    FixedBigInt<256> remainder(left);
+    remainder %= FixedBigInt<256>(right);
+    ASSERT_EQ(quotient.ToBigInt(), left / right);
+    ASSERT_EQ(remainder.ToBigInt(), left % right);
+  }
+}
+
+TEST(FixedBigInt, Conversions) {
+  FixedBigInt<128> value("-170141183460469231731687303715884105728");
+  ASSERT_EQ(value, FixedBigInt<128>(1) << 127);
+  ASSERT_EQ(value.ToBigInt(), -(BigInt(1) << 127));
+  ASSERT_EQ(FixedBigInt<128>(BigInt(1) << 128), 0);
+  ASSERT_EQ(FixedBigInt<128>(-(BigInt(1) << 128) - 5), -5);
+}
@@ -1,167 +1,1632 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
-template <size_t N, size_t M, typename T = int64_t>
-class Matrix {
+namespace matrix_detail {
+
+// Matrices up to this many bytes keep their elements inline, larger ones on
+// the heap so that they can live on the stack.
+const size_t kMatrixInlineBytes = 4096;
+
+// Contiguous element storage for a matrix of Size elements.
+template <typename T, size_t Size,
+          bool Inline = Size * sizeof(T) <= kMatrixInlineBytes>
+class MatrixStorage {
+ private:
+  std::array<T, Size> elements_;
+
+ public:
+  MatrixStorage() : elements_() {}
+  MatrixStorage(const T& element) { elements_.fill(element); }
+  T* Data() { return elements_.data(); }
+  const T* Data() const { return elements_.data(); }
+};
+
+template <typename T, size_t Size>
+class MatrixStorage<T, Size, false> {
  private:
-  std::vector<std::vector<T>> matrix_;
+  std::vector<T> elements_;
 
  public:
-  Matrix() : matrix_(std::vector<std::vector<T>>(N, std::vector<T>(M, T()))){};
-  Matrix(std::vector<std::vector<T>> matrix) : matrix_(matrix) {}
-  Matrix(const Matrix& matrix) { matrix_ = matrix.matrix_; }
-  std::vector<std::vector<T>>& Data() { return matrix_; }
-  const std::vector<std::vector<T>>& Data() const { return matrix_; }
-  Matrix(T element)
-      : matrix_(std::vector<std::vector<T>>(N, std::vector<T>(M, element))) {}
-  T& operator()(size_t itr, size_t jtr) { return matrix_[itr][jtr]; }
-  const T& operator()(size_t itr, size_t jtr) const {
-    return matrix_[itr][jtr];
+  MatrixStorage() : elements_(Size, T()) {}
+  MatrixStorage(const T& element) : elements_(Size, element) {}
+  T* Data() { return elements_.data(); }
+  const T* Data() const { return elements_.data(); }
+};
+
+// Instruction sets the elementwise kernels are built for, the best one the
+// running CPU supports is picked once at the first call.
+enum class SimdLevel { kDefault, kAvx2, kAvx512 };
+
+inline SimdLevel DetectSimdLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq")) {
+      return SimdLevel::kAvx512;
+    }
+    return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2
+                                          : SimdLevel::kDefault;
+  }();
+  return level;
+#else
+  return SimdLevel::kDefault;
+#endif
+}
+
+// In-place elementwise updates over count contiguous elements: data += other,
+// data -= other and data *= value. Integer and float or double element types
+// run vector loops compiled for SSE2, AVX2 and AVX-512 and dispatched on the
+// CPU at run time, other types a plain loop.
+template <typename T, bool Simd = (std::is_integral<T>::value &&
+                                   !std::is_same<T, bool>::value) ||
+                                  std::is_same<T, float>::value ||
+                                  std::is_same<T, double>::value>
+struct Elementwise {
+  static void Add(T* data, const T* other, size_t count) {
+    for (size_t itr = 0; itr < count; ++itr) {
+      data[itr] += other[itr];
+    }
   }
-  Matrix& operator+=(const Matrix<N, M, T>& matrix) {
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < M; ++jtr) {
-        matrix_[itr][jtr] += matrix(itr, jtr);
+  static void Subtract(T* data, const T* other, size_t count) {
+    for (size_t itr = 0; itr < count; ++itr) {
+      data[itr] -= other[itr];
+    }
+  }
+  static void Multiply(T* data, const T& value, size_t count) {
+    for (size_t itr = 0; itr < count; ++itr) {
+      data[itr] *= value;
+    }
+  }
+};
+
+template <typename T>
+struct Elementwise<T, true> {
+  enum Op { kAdd, kSubtract, kMultiply };
+  // Shorter runs stay on the inline SSE2 loop.
+  enum : size_t { kSmall = 16 };
+
+  static void Add(T* data, const T* other, size_t count) {
+    Run(kAdd, data, other, T(), count);
+  }
+  static void Subtract(T* data, const T* other, size_t count) {
+    Run(kSubtract, data, other, T(), count);
+  }
+  static void Multiply(T* data, const T& value, size_t count) {
+    Run(kMultiply, data, nullptr, value, count);
+  }
+
+ private:
+  static void Run(Op op, T* data, const T* other, T value, size_t count) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (count >= kSmall) {
+      switch (DetectSimdLevel()) {
+        case SimdLevel::kAvx512:
+          RunAvx512(op, data, other, value, count);
+          return;
+        case SimdLevel::kAvx2:
+          RunAvx2(op, data, other, value, count);
+          return;
+        case SimdLevel::kDefault:
+          break;
       }
     }
+#endif
+    Loop<16>(op, data, other, value, count);
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  __attribute__((target("avx512f,avx512dq"))) static void RunAvx512(
+      Op op, T* data, const T* other, T value, size_t count) {
+    Loop<64>(op, data, other, value, count);
+  }
+  __attribute__((target("avx2"))) static void RunAvx2(Op op, T* data,
+                                                      const T* other, T value,
+                                                      size_t count) {
+    Loop<32>(op, data, other, value, count);
+  }
+#endif
+
+  // Inlined into each RunAvx* so that the vector operations are compiled for
+  // its instruction set.
+  template <size_t Bytes>
+  __attribute__((always_inline)) static inline void Loop(Op op, T* data,
+                                                         const T* other,
+                                                         T value,
+                                                         size_t count) {
+    typedef T Vector
+        __attribute__((vector_size(Bytes), aligned(sizeof(T)), may_alias));
+    const size_t kLanes = Bytes / sizeof(T);
+    Vector* vectors = reinterpret_cast<Vector*>(data);
+    const Vector* others = reinterpret_cast<const Vector*>(other);
+    size_t size = count / kLanes;
+    switch (op) {
+      case kAdd:
+        for (size_t itr = 0; itr < size; ++itr) {
+          vectors[itr] += others[itr];
+        }
+        for (size_t itr = size * kLanes; itr < count; ++itr) {
+          data[itr] += other[itr];
+        }
+        break;
+      case kSubtract:
+        for (size_t itr = 0; itr < size; ++itr) {
+          vectors[itr] -= others[itr];
+        }
+        for (size_t itr = size * kLanes; itr < count; ++itr) {
+          data[itr] -= other[itr];
+        }
+        break;
+      case kMultiply:
+        for (size_t itr = 0; itr < size; ++itr) {
+          vectors[itr] *= value;
+        }
+        for (size_t itr = size * kLanes; itr < count; ++itr) {
+          data[itr] *= value;
+        }
+        break;
+    }
+  }
+};
+
+// Cache-oblivious transposes over row-major data: the range is halved along
+// its longer side until it is at most kBlock x kBlock, so at every cache and
+// TLB level the tiles in flight fit, without tuning for any of them. Small
+// tiles also keep power-of-two strides from running out of cache ways.
+template <typename T>
+struct Transpose {
+  enum : size_t { kBlock = 8 };
+
+  // res[cols x rows] = transposed data[rows x cols], res not aliasing data.
+  static void Copy(T* res, const T* data, size_t rows, size_t cols) {
+    CopyRange(res, data, rows, cols, 0, rows, 0, cols);
+  }
+
+  // Transposes the size x size data in place.
+  static void InPlace(T* data, size_t size) { Diagonal(data, size, 0, size); }
+
+ private:
+  static void CopyRange(T* res, const T* data, size_t rows, size_t cols,
+                        size_t row, size_t row_end, size_t col,
+                        size_t col_end) {
+    if (row_end - row >= col_end - col && row_end - row > kBlock) {
+      size_t mid = row + (row_end - row) / 2;
+      CopyRange(res, data, rows, cols, row, mid, col, col_end);
+      CopyRange(res, data, rows, cols, mid, row_end, col, col_end);
+    } else if (col_end - col > kBlock) {
+      size_t mid = col + (col_end - col) / 2;
+      CopyRange(res, data, rows, cols, row, row_end, col, mid);
+      CopyRange(res, data, rows, cols, row, row_end, mid, col_end);
+    } else {
+      for (size_t itr = row; itr < row_end; ++itr) {
+        for (size_t jtr = col; jtr < col_end; ++jtr) {
+          res[jtr * rows + itr] = data[itr * cols + jtr];
+        }
+      }
+    }
+  }
+
+  // Swaps the rows [row, row_end) x columns [col, col_end) range, which lies
+  // above the diagonal, with its mirror.
+  static void SwapRange(T* data, size_t size, size_t row, size_t row_end,
+                        size_t col, size_t col_end) {
+    if (row_end - row >= col_end - col && row_end - row > kBlock) {
+      size_t mid = row + (row_end - row) / 2;
+      SwapRange(data, size, row, mid, col, col_end);
+      SwapRange(data, size, mid, row_end, col, col_end);
+    } else if (col_end - col > kBlock) {
+      size_t mid = col + (col_end - col) / 2;
+      SwapRange(data, size, row, row_end, col, mid);
+      SwapRange(data, size, row, row_end, mid, col_end);
+    } else {
+      for (size_t itr = row; itr < row_end; ++itr) {
+        for (size_t jtr = col; jtr < col_end; ++jtr) {
+          std::swap(data[itr * size + jtr], data[jtr * size + itr]);
+        }
+      }
+    }
+  }
+
+  // Transposes the square [begin, end) x [begin, end) on the diagonal.
+  static void Diagonal(T* data, size_t size, size_t begin, size_t end) {
+    if (end - begin > kBlock) {
+      size_t mid = begin + (end - begin) / 2;
+      Diagonal(data, size, begin, mid);
+      Diagonal(data, size, mid, end);
+      SwapRange(data, size, begin, mid, mid, end);
+      return;
+    }
+    for (size_t itr = begin; itr < end; ++itr) {
+      for (size_t jtr = itr + 1; jtr < end; ++jtr) {
+        std::swap(data[itr * size + jtr], data[jtr * size + itr]);
+      }
+    }
+  }
+};
+
+}  // namespace matrix_detail
+
+template <size_t N, size_t M, typename T = int64_t>
+class Matrix;
+
+// Base of everything that has the elements of an N x M matrix: Matrix itself
+// and the lazy nodes +, - and scalar * build. Expr provides Element(index),
+// the element at row-major position index.
+//
+// A node is a read-only view of the matrices it was built from: auto c =
+// a + b reads a and b whenever c is read, so it sees later changes to them
+// and dangles once they are gone. Declare c as a Matrix to evaluate the
+// expression right away and get a matrix of its own.
+template <size_t N, size_t M, typename T, typename Expr>
+class MatrixExpression {
+ public:
+  const Expr& Self() const { return static_cast<const Expr&>(*this); }
+  T operator()(size_t itr, size_t jtr) const {
+    return Self().Element(itr * M + jtr);
+  }
+};
+
+// How a node holds an operand: matrices by reference, nodes by value.
+template <typename Expr>
+struct MatrixOperand {
+  typedef Expr Type;
+};
+
+template <size_t N, size_t M, typename T>
+struct MatrixOperand<Matrix<N, M, T>> {
+  typedef const Matrix<N, M, T>& Type;
+};
+
+// Elements are stored row-major in one contiguous block, Data() points to it
+// and Row(itr) to the start of row itr. Data() used to return the
+// std::vector<std::vector<T>> of rows; code indexing it as Data()[i][j] has
+// to use Row(i)[j] or (i, j) now. Assigning an expression evaluates it in a
+// single pass over the elements.
+template <size_t N, size_t M, typename T>
+class Matrix : public MatrixExpression<N, M, T, Matrix<N, M, T>> {
+ private:
+  matrix_detail::MatrixStorage<T, N * M> matrix_;
+
+ public:
+  Matrix() : matrix_() {}
+  Matrix(const std::vector<std::vector<T>>& matrix) {
+    for (size_t itr = 0; itr < N; ++itr) {
+      std::copy(matrix[itr].begin(), matrix[itr].end(), Row(itr));
+    }
+  }
+  Matrix(T element) : matrix_(element) {}
+  template <typename Expr>
+  Matrix(const MatrixExpression<N, M, T, Expr>& expr) {
+    *this = expr;
+  }
+  template <typename Expr>
+  Matrix& operator=(const MatrixExpression<N, M, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * M; ++itr) {
+      data[itr] = source.Element(itr);
+    }
+    return *this;
+  }
+  T* Data() { return matrix_.Data(); }
+  const T* Data() const { return matrix_.Data(); }
+  T* Row(size_t itr) { return matrix_.Data() + itr * M; }
+  const T* Row(size_t itr) const { return matrix_.Data() + itr * M; }
+  T& operator()(size_t itr, size_t jtr) { return Row(itr)[jtr]; }
+  const T& operator()(size_t itr, size_t jtr) const { return Row(itr)[jtr]; }
+  const T& Element(size_t index) const { return matrix_.Data()[index]; }
+  Matrix& operator+=(const Matrix<N, M, T>& matrix) {
+    matrix_detail::Elementwise<T>::Add(Data(), matrix.Data(), N * M);
     return *this;
   }
   Matrix& operator-=(const Matrix<N, M, T>& matrix) {
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < M; ++jtr) {
-        matrix_[itr][jtr] -= matrix(itr, jtr);
-      }
+    matrix_detail::Elementwise<T>::Subtract(Data(), matrix.Data(), N * M);
+    return *this;
+  }
+  template <typename Expr>
+  Matrix& operator+=(const MatrixExpression<N, M, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * M; ++itr) {
+      data[itr] += source.Element(itr);
     }
     return *this;
   }
-  Matrix& operator*=(const T& multiply) {
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < M; ++jtr) {
-        matrix_[itr][jtr] *= multiply;
-      }
+  template <typename Expr>
+  Matrix& operator-=(const MatrixExpression<N, M, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * M; ++itr) {
+      data[itr] -= source.Element(itr);
     }
     return *this;
   }
-  Matrix<M, N, T> Transposed() {
+  Matrix& operator*=(const T& multiply) {
+    matrix_detail::Elementwise<T>::Multiply(Data(), multiply, N * M);
+    return *this;
+  }
+  Matrix<M, N, T> Transposed() const {
     Matrix<M, N, T> transpos;
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < M; ++jtr) {
-        transpos(jtr, itr) = matrix_[itr][jtr];
+    matrix_detail::Transpose<T>::Copy(transpos.Data(), Data(), N, M);
+    return transpos;
+  }
+  bool operator==(const Matrix<N, M, T>& matrix) const {
+    return std::equal(Data(), Data() + N * M, matrix.Data());
+  }
+  // The product with matrix on at most threads threads instead of
+  // MatrixThreads().
+  template <size_t K, typename Right>
+  Matrix<N, K, T> Multiply(const MatrixExpression<M, K, T, Right>& matrix,
+                           size_t threads) const;
+};
+
+// What a lazy node has besides Element: the read-only part of the Matrix
+// API that needs no storage. Data(), Row(), writable elements and the other
+// square matrix methods need an evaluated matrix: Matrix<N, M, T>(a + b).
+template <size_t N, size_t M, typename T, typename Expr>
+class MatrixNodeBase : public MatrixExpression<N, M, T, Expr> {
+ public:
+  Matrix<M, N, T> Transposed() const {
+    return Matrix<N, M, T>(this->Self()).Transposed();
+  }
+};
+
+template <size_t N, size_t M, typename T, typename Expr>
+class MatrixNode : public MatrixNodeBase<N, M, T, Expr> {};
+
+template <size_t N, typename T, typename Expr>
+class MatrixNode<N, N, T, Expr> : public MatrixNodeBase<N, N, T, Expr> {
+ public:
+  T Trace() const {
+    const Expr& self = this->Self();
+    T trace = self.Element(0);
+    for (size_t itr = 1; itr < N; ++itr) {
+      trace += self.Element(itr * (N + 1));
+    }
+    return trace;
+  }
+};
+
+// Lazy elementwise sum and difference of two expressions.
+template <size_t N, size_t M, typename T, typename Left, typename Right,
+          bool Subtract>
+class MatrixSum
+    : public MatrixNode<N, M, T, MatrixSum<N, M, T, Left, Right, Subtract>> {
+ private:
+  typename MatrixOperand<Left>::Type left_;
+  typename MatrixOperand<Right>::Type right_;
+
+ public:
+  MatrixSum(const Left& left, const Right& right)
+      : left_(left), right_(right) {}
+  T Element(size_t index) const {
+    T element = left_.Element(index);
+    if (Subtract) {
+      element -= right_.Element(index);
+    } else {
+      element += right_.Element(index);
+    }
+    return element;
+  }
+};
+
+// Lazy product of an expression and a scalar.
+template <size_t N, size_t M, typename T, typename Expr>
+class MatrixScaled
+    : public MatrixNode<N, M, T, MatrixScaled<N, M, T, Expr>> {
+ private:
+  typename MatrixOperand<Expr>::Type expr_;
+  T multiply_;
+
+ public:
+  MatrixScaled(const Expr& expr, const T& multiply)
+      : expr_(expr), multiply_(multiply) {}
+  T Element(size_t index) const {
+    T element = expr_.Element(index);
+    element *= multiply_;
+    return element;
+  }
+};
+
+template <size_t N, size_t M, typename T, typename Left, typename Right>
+MatrixSum<N, M, T, Left, Right, false> operator+(
+    const MatrixExpression<N, M, T, Left>& matrix1,
+    const MatrixExpression<N, M, T, Right>& matrix2) {
+  return MatrixSum<N, M, T, Left, Right, false>(matrix1.Self(),
+                                                matrix2.Self());
+}
+
+template <size_t N, size_t M, typename T, typename Left, typename Right>
+MatrixSum<N, M, T, Left, Right, true> operator-(
+    const MatrixExpression<N, M, T, Left>& matrix1,
+    const MatrixExpression<N, M, T, Right>& matrix2) {
+  return MatrixSum<N, M, T, Left, Right, true>(matrix1.Self(),
+                                               matrix2.Self());
+}
+
+// The scalar is not deduced, so 2 * matrix works for any element type 2
+// converts to.
+template <size_t N, size_t M, typename T, typename Expr>
+MatrixScaled<N, M, T, Expr> operator*(
+    const MatrixExpression<N, M, T, Expr>& matrix1,
+    const typename std::common_type<T>::type& multiply) {
+  return MatrixScaled<N, M, T, Expr>(matrix1.Self(), multiply);
+}
+
+template <size_t N, size_t M, typename T, typename Expr>
+MatrixScaled<N, M, T, Expr> operator*(
+    const typename std::common_type<T>::type& multiply,
+    const MatrixExpression<N, M, T, Expr>& matrix1) {
+  return MatrixScaled<N, M, T, Expr>(matrix1.Self(), multiply);
+}
+
+template <size_t N, size_t M, typename T, typename Left, typename Right>
+bool operator==(const MatrixExpression<N, M, T, Left>& matrix1,
+                const MatrixExpression<N, M, T, Right>& matrix2) {
+  for (size_t itr = 0; itr < N * M; ++itr) {
+    if (!(matrix1.Self().Element(itr) == matrix2.Self().Element(itr))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace matrix_detail {
+
+// Register tile of the blocked multiplication for Bytes wide vectors: the
+// micro-kernel keeps kRows x kCols accumulators of the product in Vector
+// registers, two per row. Types without a tile take the generic loop.
+template <typename T, size_t Bytes>
+struct GemmTile {
+  enum : size_t { kRows = 0, kCols = 0 };
+};
+
+template <typename T, size_t Bytes>
+struct GemmVectorTile {
+  typedef T Vector
+      __attribute__((vector_size(Bytes), aligned(sizeof(T)), may_alias));
+  enum : size_t { kRows = 4, kCols = 2 * Bytes / sizeof(T) };
+};
+
+template <size_t Bytes>
+struct GemmTile<double, Bytes> : GemmVectorTile<double, Bytes> {};
+
+template <size_t Bytes>
+struct GemmTile<float, Bytes> : GemmVectorTile<float, Bytes> {};
+
+template <size_t Bytes>
+struct GemmTile<int64_t, Bytes> : GemmVectorTile<int64_t, Bytes> {};
+
+// Packing buffers of the blocked product. Callers that multiply many times
+// keep one so that they are allocated once.
+template <typename T>
+struct GemmBuffers {
+  std::vector<T> packed_left;
+  std::vector<T> packed_right;
+};
+
+// res[rows x cols] = left[rows x inner] * right[inner x cols], all row-major
+// and res not aliasing the operands. Rows of res and right are stride
+// elements apart, so a block of columns of a wider product can be computed
+// on its own. The generic version runs i-k-j so the innermost loop walks
+// rows, and sums in the same order as the definition.
+template <typename T, bool Tiled = (GemmTile<T, 16>::kRows > 0)>
+struct Gemm {
+  static void Multiply(T* res, const T* left, const T* right, size_t rows,
+                       size_t inner, size_t cols, size_t stride,
+                       GemmBuffers<T>&) {
+    Multiply(res, left, right, rows, inner, cols, stride);
+  }
+  // Nothing to share without packing, see the blocked version.
+  static void Share(std::vector<T>& shared, const T*, size_t, size_t) {
+    shared.clear();
+  }
+  static void MultiplyShared(T* res, const T* left, const T* right,
+                             const std::vector<T>&, size_t rows, size_t inner,
+                             size_t cols, size_t col, size_t stride,
+                             std::vector<T>&) {
+    Multiply(res, left, right + col, rows, inner, cols, stride);
+  }
+  static void Multiply(T* res, const T* left, const T* right, size_t rows,
+                       size_t inner, size_t cols, size_t stride) {
+    for (size_t itr = 0; itr < rows; ++itr) {
+      T* row = res + itr * stride;
+      const T* left_row = left + itr * inner;
+      for (size_t jtr = 0; jtr < cols; ++jtr) {
+        row[jtr] = left_row[0] * right[jtr];
+      }
+      for (size_t k = 1; k < inner; ++k) {
+        const T* right_row = right + k * stride;
+        for (size_t jtr = 0; jtr < cols; ++jtr) {
+          row[jtr] += left_row[k] * right_row[jtr];
+        }
       }
     }
-    return transpos;
   }
-  bool operator==(const Matrix<N, M, T>& matrix) {
-    return matrix_ == matrix.matrix_;
+};
+
+// Goto-style blocking: a kInnerBlock x kColBlock slice of right is packed
+// into kCols-wide panels that stay in L3 and L1, a kRowBlock x kInnerBlock
+// slice of left into kRows-high panels that stay in L2, and the micro-kernel
+// runs over pairs of panels. Packing pads partial panels with zeros. The
+// tile is built for SSE2, AVX2 and AVX-512 and picked on the CPU at run
+// time like the Elementwise loops, so every translation unit sees the same
+// definitions whatever its -m flags.
+template <typename T>
+struct Gemm<T, true> {
+  enum : size_t {
+    kInnerBlock = 256,
+    kRowBlock = 96,
+    kColBlock = 2048,
+    // Below this many multiplications packing costs more than it saves.
+    kSmall = 32 * 32 * 32,
+  };
+
+  static void Multiply(T* res, const T* left, const T* right, size_t rows,
+                       size_t inner, size_t cols, size_t stride) {
+    GemmBuffers<T> buffers;
+    Multiply(res, left, right, rows, inner, cols, stride, buffers);
+  }
+
+  static void Multiply(T* res, const T* left, const T* right, size_t rows,
+                       size_t inner, size_t cols, size_t stride,
+                       GemmBuffers<T>& buffers) {
+    for (size_t itr = 0; itr < rows; ++itr) {
+      std::fill(res + itr * stride, res + itr * stride + cols, T());
+    }
+    if (rows * inner * cols <= kSmall) {
+      MultiplySmall(res, left, right, rows, inner, cols, stride);
+      return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    switch (DetectSimdLevel()) {
+      case SimdLevel::kAvx512:
+        MultiplyAvx512(res, left, right, rows, inner, cols, stride, buffers);
+        return;
+      case SimdLevel::kAvx2:
+        MultiplyAvx2(res, left, right, rows, inner, cols, stride, buffers);
+        return;
+      case SimdLevel::kDefault:
+        break;
+    }
+#endif
+    Blocked<16>(res, left, right, rows, inner, cols, stride, buffers);
+  }
+
+  // For a product split into tiles of res that several threads compute:
+  // Share packs all of right[inner x stride] once, in the kInnerBlock-row
+  // slices of panels Blocked packs one at a time, and MultiplyShared
+  // computes the tile res[rows x cols] = left[rows x inner] * right[.., col,
+  // col + cols) from it. col is a multiple of the tile column count of
+  // every width, the tile res and left are passed already offset and
+  // packed_left is the caller's.
+  static void Share(std::vector<T>& shared, const T* right, size_t inner,
+                    size_t stride) {
+    switch (TileBytes()) {
+      case 64:
+        ShareAs<64>(shared, right, inner, stride);
+        return;
+      case 32:
+        ShareAs<32>(shared, right, inner, stride);
+        return;
+      default:
+        ShareAs<16>(shared, right, inner, stride);
+        return;
+    }
+  }
+
+  static void MultiplyShared(T* res, const T* left, const T*,
+                             const std::vector<T>& shared, size_t rows,
+                             size_t inner, size_t cols, size_t col,
+                             size_t stride, std::vector<T>& packed_left) {
+    for (size_t itr = 0; itr < rows; ++itr) {
+      std::fill(res + itr * stride, res + itr * stride + cols, T());
+    }
+    switch (TileBytes()) {
+#if defined(__x86_64__) || defined(__i386__)
+      case 64:
+        MultiplySharedAvx512(res, left, shared.data(), rows, inner, cols, col,
+                             stride, packed_left);
+        return;
+      case 32:
+        MultiplySharedAvx2(res, left, shared.data(), rows, inner, cols, col,
+                           stride, packed_left);
+        return;
+#endif
+      default:
+        BlockedShared<16>(res, left, shared.data(), rows, inner, cols, col,
+                          stride, packed_left);
+        return;
+    }
+  }
+
+  // Width of the vector tile Multiply and MultiplyShared run with.
+  static size_t TileBytes() {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (DetectSimdLevel()) {
+      case SimdLevel::kAvx512:
+        return 64;
+      case SimdLevel::kAvx2:
+        return 32;
+      case SimdLevel::kDefault:
+        break;
+    }
+#endif
+    return 16;
+  }
+
+  static size_t RoundUp(size_t value, size_t step) {
+    return (value + step - 1) / step * step;
+  }
+
+  static void MultiplySmall(T* res, const T* left, const T* right,
+                            size_t rows, size_t inner, size_t cols,
+                            size_t stride) {
+    for (size_t itr = 0; itr < rows; ++itr) {
+      T* row = res + itr * stride;
+      for (size_t k = 0; k < inner; ++k) {
+        T value = left[itr * inner + k];
+        const T* right_row = right + k * stride;
+        for (size_t jtr = 0; jtr < cols; ++jtr) {
+          row[jtr] += value * right_row[jtr];
+        }
+      }
+    }
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  __attribute__((target("avx512f,avx512dq"))) static void MultiplyAvx512(
+      T* res, const T* left, const T* right, size_t rows, size_t inner,
+      size_t cols, size_t stride, GemmBuffers<T>& buffers) {
+    Blocked<64>(res, left, right, rows, inner, cols, stride, buffers);
+  }
+  __attribute__((target("avx2"))) static void MultiplyAvx2(
+      T* res, const T* left, const T* right, size_t rows, size_t inner,
+      size_t cols, size_t stride, GemmBuffers<T>& buffers) {
+    Blocked<32>(res, left, right, rows, inner, cols, stride, buffers);
+  }
+  __attribute__((target("avx512f,avx512dq"))) static void
+  MultiplySharedAvx512(T* res, const T* left, const T* shared, size_t rows,
+                       size_t inner, size_t cols, size_t col, size_t stride,
+                       std::vector<T>& packed_left) {
+    BlockedShared<64>(res, left, shared, rows, inner, cols, col, stride,
+                      packed_left);
+  }
+  __attribute__((target("avx2"))) static void MultiplySharedAvx2(
+      T* res, const T* left, const T* shared, size_t rows, size_t inner,
+      size_t cols, size_t col, size_t stride, std::vector<T>& packed_left) {
+    BlockedShared<32>(res, left, shared, rows, inner, cols, col, stride,
+                      packed_left);
+  }
+#endif
+
+  template <size_t Bytes>
+  static void ShareAs(std::vector<T>& shared, const T* right, size_t inner,
+                      size_t stride) {
+    size_t width = RoundUp(stride, GemmTile<T, Bytes>::kCols);
+    shared.resize(inner * width);
+    for (size_t pc = 0; pc < inner; pc += kInnerBlock) {
+      PackRight<Bytes>(shared.data() + pc * width, right + pc * stride, stride,
+                       std::min<size_t>(kInnerBlock, inner - pc), stride);
+    }
+  }
+
+  // Blocked over a tile of a shared product, inlined like Blocked.
+  template <size_t Bytes>
+  __attribute__((always_inline)) static inline void BlockedShared(
+      T* res, const T* left, const T* shared, size_t rows, size_t inner,
+      size_t cols, size_t col, size_t stride, std::vector<T>& packed_left) {
+    enum : size_t {
+      kRows = GemmTile<T, Bytes>::kRows,
+      kCols = GemmTile<T, Bytes>::kCols,
+    };
+    size_t width = RoundUp(stride, kCols);
+    packed_left.resize(kRowBlock * kInnerBlock);
+    for (size_t pc = 0; pc < inner; pc += kInnerBlock) {
+      size_t inner_block = std::min<size_t>(kInnerBlock, inner - pc);
+      const T* packed_right = shared + pc * width + col * inner_block;
+      for (size_t ic = 0; ic < rows; ic += kRowBlock) {
+        size_t row_block = std::min<size_t>(kRowBlock, rows - ic);
+        PackLeft<Bytes>(packed_left.data(), left + ic * inner + pc, inner,
+                        row_block, inner_block);
+        for (size_t jr = 0; jr < cols; jr += kCols) {
+          for (size_t ir = 0; ir < row_block; ir += kRows) {
+            MicroKernel<Bytes>(packed_left.data() + ir * inner_block,
+                               packed_right + jr * inner_block, inner_block,
+                               res + (ic + ir) * stride + jr, stride,
+                               std::min<size_t>(kRows, row_block - ir),
+                               std::min<size_t>(kCols, cols - jr));
+          }
+        }
+      }
+    }
+  }
+
+  // Inlined into each MultiplyAvx* so that the micro-kernel is compiled for
+  // its instruction set.
+  template <size_t Bytes>
+  __attribute__((always_inline)) static inline void Blocked(
+      T* res, const T* left, const T* right, size_t rows, size_t inner,
+      size_t cols, size_t stride, GemmBuffers<T>& buffers) {
+    enum : size_t {
+      kRows = GemmTile<T, Bytes>::kRows,
+      kCols = GemmTile<T, Bytes>::kCols,
+    };
+    std::vector<T>& packed_left = buffers.packed_left;
+    std::vector<T>& packed_right = buffers.packed_right;
+    packed_left.resize(kRowBlock * kInnerBlock);
+    packed_right.resize(
+        kInnerBlock * std::min<size_t>(kColBlock, RoundUp(cols, kCols)));
+    for (size_t jc = 0; jc < cols; jc += kColBlock) {
+      size_t col_block = std::min<size_t>(kColBlock, cols - jc);
+      for (size_t pc = 0; pc < inner; pc += kInnerBlock) {
+        size_t inner_block = std::min<size_t>(kInnerBlock, inner - pc);
+        PackRight<Bytes>(packed_right.data(), right + pc * stride + jc,
+                         stride, inner_block, col_block);
+        for (size_t ic = 0; ic < rows; ic += kRowBlock) {
+          size_t row_block = std::min<size_t>(kRowBlock, rows - ic);
+          PackLeft<Bytes>(packed_left.data(), left + ic * inner + pc, inner,
+                          row_block, inner_block);
+          for (size_t jr = 0; jr < col_block; jr += kCols) {
+            for (size_t ir = 0; ir < row_block; ir += kRows) {
+              MicroKernel<Bytes>(packed_left.data() + ir * inner_block,
+                                 packed_right.data() + jr * inner_block,
+                                 inner_block,
+                                 res + (ic + ir) * stride + jc + jr, stride,
+                                 std::min<size_t>(kRows, row_block - ir),
+                                 std::min<size_t>(kCols, col_block - jr));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // packed[panel][k][i] = left[panel * kRows + i][k].
+  template <size_t Bytes>
+  static void PackLeft(T* packed, const T* left, size_t stride, size_t rows,
+                       size_t inner) {
+    const size_t kRows = GemmTile<T, Bytes>::kRows;
+    for (size_t panel = 0; panel < rows; panel += kRows) {
+      size_t height = std::min<size_t>(kRows, rows - panel);
+      for (size_t k = 0; k < inner; ++k) {
+        for (size_t itr = 0; itr < kRows; ++itr) {
+          packed[k * kRows + itr] =
+              itr < height ? left[(panel + itr) * stride + k] : T();
+        }
+      }
+      packed += kRows * inner;
+    }
+  }
+
+  // packed[panel][k][j] = right[k][panel * kCols + j].
+  template <size_t Bytes>
+  static void PackRight(T* packed, const T* right, size_t stride,
+                        size_t inner, size_t cols) {
+    const size_t kCols = GemmTile<T, Bytes>::kCols;
+    for (size_t panel = 0; panel < cols; panel += kCols) {
+      size_t width = std::min<size_t>(kCols, cols - panel);
+      for (size_t k = 0; k < inner; ++k) {
+        const T* row = right + k * stride + panel;
+        for (size_t jtr = 0; jtr < kCols; ++jtr) {
+          packed[k * kCols + jtr] = jtr < width ? row[jtr] : T();
+        }
+      }
+      packed += kCols * inner;
+    }
+  }
+
+  // res[height x width] += the product of a left and a right panel. The
+  // loops over the tile are unrolled so that the accumulators stay in
+  // registers at -O2 as well.
+  template <size_t Bytes>
+  __attribute__((always_inline)) static inline void MicroKernel(
+      const T* left, const T* right, size_t inner, T* res, size_t stride,
+      size_t height, size_t width) {
+    typedef typename GemmTile<T, Bytes>::Vector Vector;
+    enum : size_t {
+      kRows = GemmTile<T, Bytes>::kRows,
+      kCols = GemmTile<T, Bytes>::kCols,
+      kVectors = kCols * sizeof(T) / sizeof(Vector),
+    };
+    Vector acc[kRows][kVectors] = {};
+    for (size_t k = 0; k < inner; ++k) {
+      const Vector* row = reinterpret_cast<const Vector*>(right);
+#pragma GCC unroll 8
+      for (size_t itr = 0; itr < kRows; ++itr) {
+#pragma GCC unroll 8
+        for (size_t vtr = 0; vtr < kVectors; ++vtr) {
+          acc[itr][vtr] += left[itr] * row[vtr];
+        }
+      }
+      left += kRows;
+      right += kCols;
+    }
+    T tile[kRows][kCols];
+    __builtin_memcpy(tile, acc, sizeof(tile));
+    for (size_t itr = 0; itr < height; ++itr) {
+      for (size_t jtr = 0; jtr < width; ++jtr) {
+        res[itr * stride + jtr] += tile[itr][jtr];
+      }
+    }
   }
 };
 
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> operator+(const Matrix<N, M, T>& matrix1,
-                          const Matrix<N, M, T>& matrix2) {
-  Matrix<N, M, T> sum = matrix1;
-  sum += matrix2;
-  return sum;
+// Worker threads for ParallelFor, started on first use and grown on demand.
+// Each call splits its indices evenly between the participating threads, the
+// calling one included. A participant takes indices from the front of its
+// own range and, once that is empty, steals the back half of the longest
+// range left, so uneven tasks still keep every participant busy.
+class ThreadPool {
+ public:
+  static ThreadPool& Instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Runs task(index) for every index below count on at most threads threads
+  // and returns once all have finished, rethrowing the first exception.
+  template <typename Task>
+  void ParallelFor(size_t count, size_t threads, const Task& task) {
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+      for (size_t index = 0; index < count; ++index) {
+        task(index);
+      }
+      return;
+    }
+    std::shared_ptr<Job> job =
+        std::make_shared<Job>(count, threads, &Run<Task>, &task);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      while (workers_.size() < threads - 1) {
+        workers_.emplace_back(&ThreadPool::Work, this);
+      }
+      for (size_t slot = 1; slot < threads; ++slot) {
+        jobs_.push_back(job);
+      }
+    }
+    wake_.notify_all();
+    job->Participate(0);
+    job->Wait();
+  }
+
+ private:
+  struct Range {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  // One ParallelFor call. Workers may pick it up after it has finished, so it
+  // is shared, and task is only touched while indices are left.
+  class Job {
+   public:
+    Job(size_t count, size_t threads, void (*run)(const void*, size_t),
+        const void* task)
+        : ranges_(new Range[threads]),
+          threads_(threads),
+          count_(count),
+          run_(run),
+          task_(task) {
+      for (size_t slot = 0; slot < threads; ++slot) {
+        ranges_[slot].begin = count * slot / threads;
+        ranges_[slot].end = count * (slot + 1) / threads;
+      }
+    }
+
+    size_t NextSlot() { return next_slot_++; }
+
+    void Participate(size_t slot) {
+      size_t index;
+      while (Take(slot, index)) {
+        try {
+          run_(task_, index);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (++done_ == count_) {
+          finished_.notify_all();
+        }
+      }
+    }
+
+    void Wait() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      finished_.wait(lock, [this] { return done_ == count_; });
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+    }
+
+   private:
+    bool Take(size_t slot, size_t& index) {
+      Range& own = ranges_[slot];
+      {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+          index = own.begin++;
+          return true;
+        }
+      }
+      while (true) {
+        size_t victim = threads_;
+        size_t longest = 0;
+        for (size_t other = 0; other < threads_; ++other) {
+          std::lock_guard<std::mutex> lock(ranges_[other].mutex);
+          if (ranges_[other].end - ranges_[other].begin > longest) {
+            longest = ranges_[other].end - ranges_[other].begin;
+            victim = other;
+          }
+        }
+        if (victim == threads_) {
+          return false;
+        }
+        size_t begin;
+        size_t end;
+        {
+          std::lock_guard<std::mutex> lock(ranges_[victim].mutex);
+          Range& range = ranges_[victim];
+          if (range.begin == range.end) {
+            continue;
+          }
+          begin = range.begin + (range.end - range.begin) / 2;
+          end = range.end;
+          range.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        index = begin;
+        return true;
+      }
+    }
+
+    std::unique_ptr<Range[]> ranges_;
+    size_t threads_;
+    size_t count_;
+    void (*run_)(const void*, size_t);
+    const void* task_;
+    std::atomic<size_t> next_slot_{1};
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    size_t done_ = 0;
+    std::exception_ptr error_;
+  };
+
+  template <typename Task>
+  static void Run(const void* task, size_t index) {
+    (*static_cast<const Task*>(task))(index);
+  }
+
+  ThreadPool() = default;
+
+  void Work() {
+    while (true) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_) {
+          return;
+        }
+        job = jobs_.front();
+        jobs_.pop_front();
+      }
+      job->Participate(job->NextSlot());
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::deque<std::shared_ptr<Job>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+inline std::atomic<size_t>& MatrixThreadCount() {
+  static std::atomic<size_t> threads(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  return threads;
 }
 
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> operator-(const Matrix<N, M, T>& matrix1,
-                          const Matrix<N, M, T>& matrix2) {
-  Matrix<N, M, T> sum = matrix1;
-  sum -= matrix2;
-  return sum;
+}  // namespace matrix_detail
+
+// Threads operator* may use for large products, the hardware concurrency
+// unless set. 1 keeps every product on the calling thread.
+inline size_t MatrixThreads() {
+  return matrix_detail::MatrixThreadCount().load();
 }
 
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> operator*(const Matrix<N, M, T>& matrix1, const T& multiply) {
-  Matrix<N, M, T> sum = matrix1;
-  sum *= multiply;
-  return sum;
+inline void SetMatrixThreads(size_t threads) {
+  matrix_detail::MatrixThreadCount() = std::max<size_t>(threads, 1);
 }
 
+namespace matrix_detail {
+
+// Products with fewer multiplications than this always run on the calling
+// thread, chosen at compile time so that they never touch the pool.
+const size_t kParallelProduct = 128 * 128 * 128;
+
+// res[N x K] = left[N x M] * right[M x K]. Large products are cut into
+// kRowTile x kColTile tiles of res that the pool computes independently.
+template <size_t N, size_t M, size_t K, typename T,
+          bool Parallel = (N * M * K >= kParallelProduct)>
+struct Product {
+  static void Multiply(T* res, const T* left, const T* right) {
+    Gemm<T>::Multiply(res, left, right, N, M, K, K);
+  }
+  static void Multiply(T* res, const T* left, const T* right, size_t) {
+    Multiply(res, left, right);
+  }
+  static void Multiply(T* res, const T* left, const T* right,
+                       GemmBuffers<T>& buffers) {
+    Gemm<T>::Multiply(res, left, right, N, M, K, K, buffers);
+  }
+};
+
+template <size_t N, size_t M, size_t K, typename T>
+struct Product<N, M, K, T, true> {
+  enum : size_t {
+    kRowTile = 96,
+    kColTile = 512,
+    kRowTiles = (N + kRowTile - 1) / kRowTile,
+    kColTiles = (K + kColTile - 1) / kColTile,
+  };
+
+  static void Multiply(T* res, const T* left, const T* right) {
+    GemmBuffers<T> buffers;
+    Multiply(res, left, right, MatrixThreads(), buffers);
+  }
+  static void Multiply(T* res, const T* left, const T* right,
+                       size_t threads) {
+    GemmBuffers<T> buffers;
+    Multiply(res, left, right, threads, buffers);
+  }
+  static void Multiply(T* res, const T* left, const T* right,
+                       GemmBuffers<T>& buffers) {
+    Multiply(res, left, right, MatrixThreads(), buffers);
+  }
+  // buffers serve the product when it stays on the calling thread. Split
+  // up, right is packed once into buffers for all tiles, and every thread
+  // packs left into a buffer of its own that it keeps for later tiles.
+  static void Multiply(T* res, const T* left, const T* right, size_t threads,
+                       GemmBuffers<T>& buffers) {
+    if (threads <= 1) {
+      Gemm<T>::Multiply(res, left, right, N, M, K, K, buffers);
+      return;
+    }
+    const std::vector<T>& shared = buffers.packed_right;
+    Gemm<T>::Share(buffers.packed_right, right, M, K);
+    ThreadPool::Instance().ParallelFor(
+        kRowTiles * kColTiles, threads, [=, &shared](size_t tile) {
+          thread_local std::vector<T> packed_left;
+          size_t row = tile / kColTiles * kRowTile;
+          size_t col = tile % kColTiles * kColTile;
+          Gemm<T>::MultiplyShared(res + row * K + col, left + row * M, right,
+                                  shared, std::min<size_t>(kRowTile, N - row),
+                                  M, std::min<size_t>(kColTile, K - col), col,
+                                  K, packed_left);
+        });
+  }
+};
+
+// An operand of the product in one contiguous block: a matrix as it is, an
+// expression evaluated into a temporary.
+template <size_t N, size_t M, typename T, typename Expr>
+struct MatrixEvaluated {
+  explicit MatrixEvaluated(const Expr& expr) : matrix(expr) {}
+  const Matrix<N, M, T> matrix;
+};
+
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T> operator*(const T& multiply, const Matrix<N, M, T>& matrix1) {
-  Matrix<N, M, T> sum = matrix1;
-  sum *= multiply;
-  return sum;
+struct MatrixEvaluated<N, M, T, Matrix<N, M, T>> {
+  explicit MatrixEvaluated(const Matrix<N, M, T>& expr) : matrix(expr) {}
+  const Matrix<N, M, T>& matrix;
+};
+
+}  // namespace matrix_detail
+
+template <size_t N, size_t M, size_t K, typename T, typename Left,
+          typename Right>
+Matrix<N, K, T> operator*(const MatrixExpression<N, M, T, Left>& matrix1,
+                          const MatrixExpression<M, K, T, Right>& matrix2) {
+  matrix_detail::MatrixEvaluated<N, M, T, Left> left(matrix1.Self());
+  matrix_detail::MatrixEvaluated<M, K, T, Right> right(matrix2.Self());
+  Matrix<N, K, T> multiply;
+  matrix_detail::Product<N, M, K, T>::Multiply(
+      multiply.Data(), left.matrix.Data(), right.matrix.Data());
+  return multiply;
 }
 
-template <size_t N, size_t M, size_t K, typename T>
-Matrix<N, K, T> operator*(const Matrix<N, M, T>& matrix1,
-                          const Matrix<M, K, T>& matrix2) {
+template <size_t N, size_t M, typename T>
+template <size_t K, typename Right>
+Matrix<N, K, T> Matrix<N, M, T>::Multiply(
+    const MatrixExpression<M, K, T, Right>& matrix, size_t threads) const {
+  matrix_detail::MatrixEvaluated<M, K, T, Right> right(matrix.Self());
   Matrix<N, K, T> multiply;
-  for (size_t itr = 0; itr < N; ++itr) {
-    for (size_t jtr = 0; jtr < K; ++jtr) {
-      multiply(itr, jtr) = matrix1(itr, 0) * matrix2(0, jtr);
-      for (size_t k = 1; k < M; ++k) {
-        multiply(itr, jtr) += matrix1(itr, k) * matrix2(k, jtr);
+  matrix_detail::Product<N, M, K, T>::Multiply(
+      multiply.Data(), Data(), right.matrix.Data(), threads);
+  return multiply;
+}
+
+namespace matrix_detail {
+
+// Size of a pivot candidate. Arithmetic types compare with zero, which
+// unlike std::abs also works for unsigned ones, other types use the abs
+// argument-dependent lookup finds, std::abs for std::complex.
+template <typename T, bool Arithmetic = std::is_arithmetic<T>::value>
+struct PivotSize {
+  static auto Of(const T& value) -> decltype(abs(value)) {
+    return abs(value);
+  }
+};
+
+template <typename T>
+struct PivotSize<T, true> {
+  static T Of(const T& value) { return value < T() ? T(-value) : value; }
+};
+
+// Determinant and inverse of a size x size row-major matrix, overwriting
+// data. This version factors data = P * L * U with partial pivoting,
+// kBlock columns at a time: each panel is factored on its own and the rest
+// of the matrix updated with one Gemm product, and the triangular solves of
+// the inverse are blocked the same way.
+template <typename T,
+          bool Exact = std::is_integral<T>::value &&
+                       !std::is_same<T, bool>::value,
+          bool Signed = std::is_signed<T>::value>
+struct Elimination {
+  enum : size_t { kBlock = 64 };
+
+  // What SubtractProduct packs into, kept for a whole elimination.
+  struct Workspace {
+    std::vector<T> panel;
+    std::vector<T> product;
+    GemmBuffers<T> gemm;
+  };
+
+  // T() if data is singular.
+  static T Determinant(T* data, size_t size) {
+    std::vector<size_t> pivots(size);
+    if (!Factor(data, size, pivots.data())) {
+      return T();
+    }
+    T determinant = T(1);
+    for (size_t itr = 0; itr < size; ++itr) {
+      determinant *= data[itr * size + itr];
+      if (pivots[itr] != itr) {
+        determinant = -determinant;
       }
     }
+    return determinant;
   }
-  return multiply;
-}
+
+  static void Inverse(T* res, T* data, size_t size) {
+    std::vector<size_t> pivots(size);
+    if (!Factor(data, size, pivots.data())) {
+      throw std::domain_error("singular matrix");
+    }
+    std::fill(res, res + size * size, T());
+    for (size_t itr = 0; itr < size; ++itr) {
+      res[itr * size + itr] = T(1);
+    }
+    for (size_t itr = 0; itr < size; ++itr) {
+      std::swap_ranges(res + itr * size, res + (itr + 1) * size,
+                       res + pivots[itr] * size);
+    }
+    Workspace workspace;
+    // res = L^-1 * res, top down.
+    for (size_t begin = 0; begin < size; begin += kBlock) {
+      size_t end = std::min<size_t>(begin + kBlock, size);
+      SubtractProduct(res + begin * size, data + begin * size, size, res,
+                      end - begin, begin, size, size, workspace);
+      for (size_t itr = begin; itr < end; ++itr) {
+        for (size_t k = begin; k < itr; ++k) {
+          SubtractRow(res + itr * size, data[itr * size + k], res + k * size,
+                      size);
+        }
+      }
+    }
+    // res = U^-1 * res, bottom up.
+    for (size_t end = size; end > 0;) {
+      size_t begin = end > kBlock ? end - kBlock : 0;
+      SubtractProduct(res + begin * size, data + begin * size + end, size,
+                      res + end * size, end - begin, size - end, size, size,
+                      workspace);
+      for (size_t itr = end; itr-- > begin;) {
+        T* row = res + itr * size;
+        for (size_t k = itr + 1; k < end; ++k) {
+          SubtractRow(row, data[itr * size + k], res + k * size, size);
+        }
+        T inverse = T(1) / data[itr * size + itr];
+        for (size_t jtr = 0; jtr < size; ++jtr) {
+          row[jtr] *= inverse;
+        }
+      }
+      end = begin;
+    }
+  }
+
+  // Factors data in place into the unit lower triangle L and the upper
+  // triangle U. Row k was swapped with row pivots[k] >= k before step k.
+  // False if a pivot column is all zeros.
+  static bool Factor(T* data, size_t size, size_t* pivots) {
+    Workspace workspace;
+    for (size_t begin = 0; begin < size; begin += kBlock) {
+      size_t end = std::min<size_t>(begin + kBlock, size);
+      for (size_t k = begin; k < end; ++k) {
+        size_t pivot = k;
+        auto largest = PivotSize<T>::Of(data[k * size + k]);
+        for (size_t itr = k + 1; itr < size; ++itr) {
+          auto candidate = PivotSize<T>::Of(data[itr * size + k]);
+          if (candidate > largest) {
+            largest = candidate;
+            pivot = itr;
+          }
+        }
+        if (data[pivot * size + k] == T()) {
+          return false;
+        }
+        pivots[k] = pivot;
+        if (pivot != k) {
+          std::swap_ranges(data + k * size, data + (k + 1) * size,
+                           data + pivot * size);
+        }
+        const T* row = data + k * size;
+        T inverse = T(1) / row[k];
+        for (size_t itr = k + 1; itr < size; ++itr) {
+          T* other = data + itr * size;
+          other[k] *= inverse;
+          for (size_t jtr = k + 1; jtr < end; ++jtr) {
+            other[jtr] -= other[k] * row[jtr];
+          }
+        }
+      }
+      if (end == size) {
+        break;
+      }
+      // U12 = L11^-1 * A12, then A22 -= L21 * U12.
+      for (size_t itr = begin + 1; itr < end; ++itr) {
+        for (size_t k = begin; k < itr; ++k) {
+          SubtractRow(data + itr * size + end, data[itr * size + k],
+                      data + k * size + end, size - end);
+        }
+      }
+      SubtractProduct(data + end * size + end, data + end * size + begin, size,
+                      data + begin * size + end, size - end, end - begin,
+                      size - end, size, workspace);
+    }
+    return true;
+  }
+
+  static void SubtractRow(T* row, const T& multiply, const T* other,
+                          size_t count) {
+    for (size_t jtr = 0; jtr < count; ++jtr) {
+      row[jtr] -= multiply * other[jtr];
+    }
+  }
+
+  // res[rows x cols] -= left[rows x inner] * right[inner x cols]. Rows of
+  // res and right are stride apart, of left left_stride. left is copied into
+  // the workspace panel and the product written to its product.
+  static void SubtractProduct(T* res, const T* left, size_t left_stride,
+                              const T* right, size_t rows, size_t inner,
+                              size_t cols, size_t stride,
+                              Workspace& workspace) {
+    if (rows == 0 || inner == 0 || cols == 0) {
+      return;
+    }
+    std::vector<T>& panel = workspace.panel;
+    std::vector<T>& product = workspace.product;
+    panel.resize(rows * inner);
+    product.resize(rows * stride);
+    for (size_t itr = 0; itr < rows; ++itr) {
+      std::copy(left + itr * left_stride, left + itr * left_stride + inner,
+                panel.data() + itr * inner);
+    }
+    Gemm<T>::Multiply(product.data(), panel.data(), right, rows, inner, cols,
+                      stride, workspace.gemm);
+    for (size_t itr = 0; itr < rows; ++itr) {
+      T* row = res + itr * stride;
+      const T* sub = product.data() + itr * stride;
+      for (size_t jtr = 0; jtr < cols; ++jtr) {
+        row[jtr] -= sub[jtr];
+      }
+    }
+  }
+};
+
+// Signed integers are eliminated fraction-free with Bareiss' algorithm:
+// every entry stays a minor of the matrix, so all divisions are exact and
+// nothing is rounded. Products are formed in Wide so that they cannot
+// overflow before the division.
+template <typename T>
+struct Elimination<T, true, true> {
+  typedef typename std::conditional<(sizeof(T) < sizeof(int64_t)), int64_t,
+                                    __int128>::type Wide;
+
+  static T Determinant(T* data, size_t size) {
+    T previous = T(1);
+    bool negate = false;
+    for (size_t k = 0; k < size; ++k) {
+      size_t pivot = Pivot(data, size, size, k);
+      if (pivot == size) {
+        return T();
+      }
+      negate ^= pivot != k;
+      for (size_t itr = k + 1; itr < size; ++itr) {
+        Combine(data + itr * size, data + k * size, k, size, previous);
+      }
+      previous = data[k * size + k];
+    }
+    return negate ? -previous : previous;
+  }
+
+  // Fraction-free Gauss-Jordan on [data | I]: once every column is
+  // eliminated the right half holds det * data^-1, the adjugate up to sign.
+  // Throws if data is singular or its inverse is not integral.
+  static void Inverse(T* res, T* data, size_t size) {
+    size_t width = 2 * size;
+    std::vector<T> augmented(size * width, T());
+    for (size_t itr = 0; itr < size; ++itr) {
+      std::copy(data + itr * size, data + (itr + 1) * size,
+                augmented.data() + itr * width);
+      augmented[itr * width + size + itr] = T(1);
+    }
+    T previous = T(1);
+    for (size_t k = 0; k < size; ++k) {
+      if (Pivot(augmented.data(), width, size, k) == size) {
+        throw std::domain_error("singular matrix");
+      }
+      const T* row = augmented.data() + k * width;
+      for (size_t itr = 0; itr < size; ++itr) {
+        if (itr != k) {
+          Combine(augmented.data() + itr * width, row, k, width, previous);
+        }
+      }
+      previous = row[k];
+    }
+    for (size_t itr = 0; itr < size; ++itr) {
+      const T* row = augmented.data() + itr * width + size;
+      for (size_t jtr = 0; jtr < size; ++jtr) {
+        if (row[jtr] % previous != T()) {
+          throw std::domain_error("matrix has no integer inverse");
+        }
+        res[itr * size + jtr] = row[jtr] / previous;
+      }
+    }
+  }
+
+  // Brings a row with a nonzero entry in column k to row k, looking at rows
+  // k and below of a width-wide block. The row it came from, size if the
+  // column is all zeros.
+  static size_t Pivot(T* data, size_t width, size_t size, size_t k) {
+    size_t pivot = k;
+    while (pivot < size && data[pivot * width + k] == T()) {
+      ++pivot;
+    }
+    if (pivot != k && pivot != size) {
+      std::swap_ranges(data + k * width, data + (k + 1) * width,
+                       data + pivot * width);
+    }
+    return pivot;
+  }
+
+  // row[j] = (row[j] * pivot[k] - row[k] * pivot[j]) / previous for j in
+  // (k, width).
+  static void Combine(T* row, const T* pivot, size_t k, size_t width,
+                      T previous) {
+    Wide scale = pivot[k];
+    Wide factor = row[k];
+    for (size_t jtr = k + 1; jtr < width; ++jtr) {
+      Wide value = row[jtr] * scale - factor * pivot[jtr];
+      // A 64-bit division is several times cheaper than a 128-bit one.
+      if (value == static_cast<int64_t>(value)) {
+        row[jtr] = T(static_cast<int64_t>(value) / previous);
+      } else {
+        row[jtr] = T(value / previous);
+      }
+    }
+  }
+};
+
+// Unsigned integers are eliminated as the signed integers of the same width,
+// which gives the exact results reduced modulo 2^bits as long as every minor
+// fits the signed type.
+template <typename T>
+struct Elimination<T, true, false> {
+  typedef typename std::make_signed<T>::type Signed;
+
+  static T Determinant(T* data, size_t size) {
+    return T(Elimination<Signed>::Determinant(reinterpret_cast<Signed*>(data),
+                                              size));
+  }
+
+  static void Inverse(T* res, T* data, size_t size) {
+    Elimination<Signed>::Inverse(reinterpret_cast<Signed*>(res),
+                                 reinterpret_cast<Signed*>(data), size);
+  }
+};
+
+}  // namespace matrix_detail
 
 template <size_t N, typename T>
-class Matrix<N, N, T> {
+class Matrix<N, N, T> : public MatrixExpression<N, N, T, Matrix<N, N, T>> {
  private:
-  std::vector<std::vector<T>> matrix_;
+  matrix_detail::MatrixStorage<T, N * N> matrix_;
 
  public:
-  Matrix() : matrix_(std::vector<std::vector<T>>(N, std::vector<T>(N, T()))){};
-  Matrix(std::vector<std::vector<T>> matrix) : matrix_(matrix) {}
-  Matrix(const Matrix& matrix) { matrix_ = matrix.matrix_; }
-  std::vector<std::vector<T>>& Data() { return matrix_; }
-  const std::vector<std::vector<T>>& Data() const { return matrix_; }
-  Matrix(T element)
-      : matrix_(std::vector<std::vector<T>>(N, std::vector<T>(N, element))) {}
-  T& operator()(size_t itr, size_t jtr) { return matrix_[itr][jtr]; }
-  const T& operator()(size_t itr, size_t jtr) const {
-    return matrix_[itr][jtr];
-  }
-  Matrix operator+=(const Matrix<N, N, T>& matrix) {
+  Matrix() : matrix_() {}
+  Matrix(const std::vector<std::vector<T>>& matrix) {
     for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < N; ++jtr) {
-        matrix_[itr][jtr] += matrix(itr, jtr);
-      }
+      std::copy(matrix[itr].begin(), matrix[itr].end(), Row(itr));
+    }
+  }
+  Matrix(T element) : matrix_(element) {}
+  template <typename Expr>
+  Matrix(const MatrixExpression<N, N, T, Expr>& expr) {
+    *this = expr;
+  }
+  template <typename Expr>
+  Matrix& operator=(const MatrixExpression<N, N, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * N; ++itr) {
+      data[itr] = source.Element(itr);
     }
     return *this;
   }
-  Matrix operator-=(const Matrix<N, N, T>& matrix) {
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < N; ++jtr) {
-        matrix_[itr][jtr] -= matrix(itr, jtr);
-      }
+  T* Data() { return matrix_.Data(); }
+  const T* Data() const { return matrix_.Data(); }
+  T* Row(size_t itr) { return matrix_.Data() + itr * N; }
+  const T* Row(size_t itr) const { return matrix_.Data() + itr * N; }
+  T& operator()(size_t itr, size_t jtr) { return Row(itr)[jtr]; }
+  const T& operator()(size_t itr, size_t jtr) const { return Row(itr)[jtr]; }
+  const T& Element(size_t index) const { return matrix_.Data()[index]; }
+  Matrix& operator+=(const Matrix<N, N, T>& matrix) {
+    matrix_detail::Elementwise<T>::Add(Data(), matrix.Data(), N * N);
+    return *this;
+  }
+  Matrix& operator-=(const Matrix<N, N, T>& matrix) {
+    matrix_detail::Elementwise<T>::Subtract(Data(), matrix.Data(), N * N);
+    return *this;
+  }
+  template <typename Expr>
+  Matrix& operator+=(const MatrixExpression<N, N, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * N; ++itr) {
+      data[itr] += source.Element(itr);
     }
     return *this;
   }
-  Matrix operator*=(const T& multiply) {
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < N; ++jtr) {
-        matrix_[itr][jtr] *= multiply;
-      }
+  template <typename Expr>
+  Matrix& operator-=(const MatrixExpression<N, N, T, Expr>& expr) {
+    const Expr& source = expr.Self();
+    T* data = Data();
+#pragma GCC ivdep
+    for (size_t itr = 0; itr < N * N; ++itr) {
+      data[itr] -= source.Element(itr);
     }
     return *this;
   }
-  Matrix<N, N, T> Transposed() {
+  Matrix& operator*=(const T& multiply) {
+    matrix_detail::Elementwise<T>::Multiply(Data(), multiply, N * N);
+    return *this;
+  }
+  Matrix<N, N, T> Transposed() const {
     Matrix<N, N, T> transpos;
-    for (size_t itr = 0; itr < N; ++itr) {
-      for (size_t jtr = 0; jtr < N; ++jtr) {
-        transpos(jtr, itr) = matrix_[itr][jtr];
-      }
-    }
+    matrix_detail::Transpose<T>::Copy(transpos.Data(), Data(), N, N);
     return transpos;
   }
-  bool operator==(const Matrix<N, N, T>& matrix) {
-    return matrix_ == matrix.matrix_;
+  void TransposeInPlace() {
+    matrix_detail::Transpose<T>::InPlace(Data(), N);
   }
-  T Trace() {
-    T trace = matrix_[0][0];
+  bool operator==(const Matrix<N, N, T>& matrix) const {
+    return std::equal(Data(), Data() + N * N, matrix.Data());
+  }
+  // The product with matrix on at most threads threads instead of
+  // MatrixThreads().
+  template <size_t K, typename Right>
+  Matrix<N, K, T> Multiply(const MatrixExpression<N, K, T, Right>& matrix,
+                           size_t threads) const {
+    matrix_detail::MatrixEvaluated<N, K, T, Right> right(matrix.Self());
+    Matrix<N, K, T> multiply;
+    matrix_detail::Product<N, N, K, T>::Multiply(
+        multiply.Data(), Data(), right.matrix.Data(), threads);
+    return multiply;
+  }
+  T Trace() const {
+    const T* data = Data();
+    T trace = data[0];
     for (size_t itr = 1; itr < N; ++itr) {
-      trace += matrix_[itr][itr];
+      trace += data[itr * (N + 1)];
     }
     return trace;
   }
-};
\ No newline at end of file
+  // By repeated squaring, ping-ponging between the same three matrices,
+  // which trade places through pointers, and one set of packing buffers.
+  Matrix<N, N, T> Pow(uint64_t power) const {
+    Matrix<N, N, T> matrices[3];
+    if (power == 0) {
+      for (size_t itr = 0; itr < N; ++itr) {
+        matrices[0](itr, itr) = T(1);
+      }
+      return matrices[0];
+    }
+    Matrix<N, N, T>* result = &matrices[0];
+    Matrix<N, N, T>* square = &matrices[1];
+    Matrix<N, N, T>* product = &matrices[2];
+    *square = *this;
+    matrix_detail::GemmBuffers<T> packing;
+    bool empty = true;
+    while (true) {
+      if (power & 1) {
+        if (empty) {
+          *result = *square;
+          empty = false;
+        } else {
+          matrix_detail::Product<N, N, N, T>::Multiply(
+              product->Data(), result->Data(), square->Data(), packing);
+          std::swap(result, product);
+        }
+      }
+      power >>= 1;
+      if (power == 0) {
+        return std::move(*result);
+      }
+      matrix_detail::Product<N, N, N, T>::Multiply(
+          product->Data(), square->Data(), square->Data(), packing);
+      std::swap(square, product);
+    }
+  }
+  T Determinant() const {
+    Matrix<N, N, T> copy = *this;
+    return matrix_detail::Elimination<T>::Determinant(copy.Data(), N);
+  }
+  // Throws std::domain_error if the matrix is singular or, for integer
+  // elements, its inverse is not integral.
+  Matrix<N, N, T> Inverse() const {
+    Matrix<N, N, T> copy = *this;
+    Matrix<N, N, T> inverse;
+    matrix_detail::Elimination<T>::Inverse(inverse.Data(), copy.Data(), N);
+    return inverse;
+  }
+};
@@ -0,0 +1,267 @@
+#include "matrix.hpp"
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Entries in [-range, range].
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> Random(std::mt19937_64& gen, int range) {
+  Matrix<N, M, T> matrix;
+  for (size_t itr = 0; itr < N; ++itr) {
+    for (size_t jtr = 0; jtr < M; ++jtr) {
+      matrix(itr, jtr) =
+          T(static_cast<int>(gen() % (2 * range + 1)) - range);
+    }
+  }
+  return matrix;
+}
+
+template <size_t N, typename T>
+Matrix<N, N, T> Identity() {
+  Matrix<N, N, T> identity;
+  for (size_t itr = 0; itr < N; ++itr) {
+    identity(itr, itr) = T(1);
+  }
+  return identity;
+}
+
+// The textbook triple loop.
+template <size_t N, typename T>
+Matrix<N, N, T> ReferenceProduct(const Matrix<N, N, T>& left,
+                                 const Matrix<N, N, T>& right) {
+  Matrix<N, N, T> res;
+  for (size_t itr = 0; itr < N; ++itr) {
+    for (size_t jtr = 0; jtr < N; ++jtr) {
+      for (size_t ktr = 0; ktr < N; ++ktr) {
+        res(itr, jtr) += left(itr, ktr) * right(ktr, jtr);
+      }
+    }
+  }
+  return res;
+}
+
+template <size_t N, typename T>
+Matrix<N, N, T> ReferencePow(const Matrix<N, N, T>& matrix, uint64_t power) {
+  Matrix<N, N, T> res = Identity<N, T>();
+  for (uint64_t itr = 0; itr < power; ++itr) {
+    res = ReferenceProduct(res, matrix);
+  }
+  return res;
+}
+
+// Laplace expansion along the first row.
+int64_t ReferenceDeterminant(const std::vector<std::vector<int64_t>>& rows) {
+  size_t size = rows.size();
+  if (size == 1) {
+    return rows[0][0];
+  }
+  int64_t determinant = 0;
+  for (size_t col = 0; col < size; ++col) {
+    std::vector<std::vector<int64_t>> minor;
+    for (size_t itr = 1; itr < size; ++itr) {
+      minor.emplace_back();
+      for (size_t jtr = 0; jtr < size; ++jtr) {
+        if (jtr != col) {
+          minor.back().push_back(rows[itr][jtr]);
+        }
+      }
+    }
+    int64_t term = rows[0][col] * ReferenceDeterminant(minor);
+    determinant += col % 2 == 0 ? term : -term;
+  }
+  return determinant;
+}
+
+template <size_t N, typename T>
+std::vector<std::vector<int64_t>> Rows(const Matrix<N, N, T>& matrix) {
+  std::vector<std::vector<int64_t>> rows(N, std::vector<int64_t>(N));
+  for (size_t itr = 0; itr < N; ++itr) {
+    for (size_t jtr = 0; jtr < N; ++jtr) {
+      rows[itr][jtr] = static_cast<int64_t>(matrix(itr, jtr));
+    }
+  }
+  return rows;
+}
+
+template <size_t N, typename T>
+void CheckDeterminants(std::mt19937_64& gen) {
+  for (int itr = 0; itr < 20; ++itr) {
+    Matrix<N, N, T> matrix = Random<N, N, T>(gen, 4);
+    ASSERT_EQ(std::llround(static_cast<double>(matrix.Determinant())),
+              ReferenceDeterminant(Rows(matrix)));
+  }
+}
+
+// Unit lower times upper triangular with rows swapped, so the determinant is
+// known and the elimination needs pivoting. Small off-diagonal entries keep
+// it well conditioned.
+template <size_t N>
+Matrix<N, N, double> KnownDeterminant(std::mt19937_64& gen,
+                                      double& determinant) {
+  Matrix<N, N, double> lower = Identity<N, double>();
+  Matrix<N, N, double> upper;
+  determinant = 1;
+  for (size_t itr = 0; itr < N; ++itr) {
+    for (size_t jtr = 0; jtr < itr; ++jtr) {
+      lower(itr, jtr) = static_cast<double>(gen() % 3) / 8 - 0.125;
+    }
+    upper(itr, itr) = itr % 3 == 0 ? -1.0 : 1.0 + static_cast<double>(itr % 2);
+    determinant *= upper(itr, itr);
+    for (size_t jtr = itr + 1; jtr < N; ++jtr) {
+      upper(itr, jtr) = static_cast<double>(gen() % 3) / 8 - 0.125;
+    }
+  }
+  Matrix<N, N, double> product = ReferenceProduct(lower, upper);
+  for (size_t jtr = 0; jtr < N; ++jtr) {
+    std::swap(product(0, jtr), product(N - 1, jtr));
+  }
+  determinant = -determinant;
+  return product;
+}
+
+template <size_t N, typename T>
+void ExpectNear(const Matrix<N, N, T>& left, const Matrix<N, N, T>& right,
+                double tolerance) {
+  for (size_t itr = 0; itr < N; ++itr) {
+    for (size_t jtr = 0; jtr < N; ++jtr) {
+      ASSERT_NEAR(left(itr, jtr), right(itr, jtr), tolerance);
+    }
+  }
+}
+
+}  // namespace
+
+// Small integer entries keep every double exact, so the squaring order of
+// Pow cannot change the result. 70 crosses the packing tile sizes.
+TEST(Pow, MatchesRepeatedProduct) {
+  std::mt19937_64 gen(1);
+  for (uint64_t power : {0, 1, 2, 3, 4, 7, 10}) {
+    Matrix<1, 1, int64_t> one = Random<1, 1, int64_t>(gen, 3);
+    ASSERT_EQ(one.Pow(power), ReferencePow(one, power));
+    Matrix<17, 17, int64_t> odd = Random<17, 17, int64_t>(gen, 1);
+    ASSERT_EQ(odd.Pow(power), ReferencePow(odd, power));
+    Matrix<17, 17, double> real = Random<17, 17, double>(gen, 1);
+    ASSERT_EQ(real.Pow(power), ReferencePow(real, power));
+  }
+  Matrix<70, 70, double> large = Random<70, 70, double>(gen, 1);
+  ASSERT_EQ(large.Pow(5), ReferencePow(large, 5));
+  Matrix<70, 70, int32_t> narrow = Random<70, 70, int32_t>(gen, 1);
+  ASSERT_EQ(narrow.Pow(4), ReferencePow(narrow, 4));
+}
+
+// Unsigned elements wrap modulo 2^64 in both, so long powers are comparable.
+TEST(Pow, WrapsLikeRepeatedProduct) {
+  std::mt19937_64 gen(2);
+  Matrix<5, 5, uint64_t> matrix;
+  for (size_t itr = 0; itr < 5; ++itr) {
+    for (size_t jtr = 0; jtr < 5; ++jtr) {
+      matrix(itr, jtr) = gen();
+    }
+  }
+  ASSERT_EQ(matrix.Pow(1000), ReferencePow(matrix, 1000));
+  Matrix<2, 2, uint64_t> fibonacci(std::vector<std::vector<uint64_t>>{
+      {1, 1}, {1, 0}});
+  ASSERT_EQ(fibonacci.Pow(90)(0, 1), 2880067194370816120ULL);
+}
+
+TEST(Determinant, MatchesLaplace) {
+  std::mt19937_64 gen(3);
+  CheckDeterminants<1, int64_t>(gen);
+  CheckDeterminants<2, int64_t>(gen);
+  CheckDeterminants<5, int64_t>(gen);
+  CheckDeterminants<7, int64_t>(gen);
+  CheckDeterminants<7, int32_t>(gen);
+  CheckDeterminants<6, double>(gen);
+}
+
+TEST(Determinant, Unsigned) {
+  Matrix<2, 2, uint64_t> matrix(std::vector<std::vector<uint64_t>>{
+      {2, 3}, {1, 2}});
+  ASSERT_EQ(matrix.Determinant(), 1);
+  Matrix<2, 2, uint64_t> swapped(std::vector<std::vector<uint64_t>>{
+      {1, 2}, {2, 3}});
+  ASSERT_EQ(swapped.Determinant(), uint64_t(-1));
+}
+
+// 70 columns take more than one 64-column panel of the blocked LU.
+TEST(Determinant, BlockedLu) {
+  std::mt19937_64 gen(4);
+  double determinant;
+  Matrix<70, 70, double> matrix = KnownDeterminant<70>(gen, determinant);
+  ASSERT_NEAR(matrix.Determinant() / determinant, 1.0, 1e-9);
+}
+
+TEST(Determinant, Singular) {
+  std::mt19937_64 gen(5);
+  Matrix<6, 6, int64_t> matrix = Random<6, 6, int64_t>(gen, 5);
+  for (size_t jtr = 0; jtr < 6; ++jtr) {
+    matrix(4, jtr) = matrix(1, jtr) * 3;
+  }
+  ASSERT_EQ(matrix.Determinant(), 0);
+  Matrix<3, 3, int64_t> zero;
+  ASSERT_EQ(zero.Determinant(), 0);
+  Matrix<70, 70, double> real = Random<70, 70, double>(gen, 3);
+  for (size_t jtr = 0; jtr < 70; ++jtr) {
+    real(69, jtr) = 0;
+  }
+  ASSERT_EQ(real.Determinant(), 0);
+}
+
+TEST(Inverse, Real) {
+  std::mt19937_64 gen(6);
+  double determinant;
+  Matrix<70, 70, double> matrix = KnownDeterminant<70>(gen, determinant);
+  Matrix<70, 70, double> inverse = matrix.Inverse();
+  ExpectNear(ReferenceProduct(matrix, inverse), Identity<70, double>(), 1e-6);
+  Matrix<3, 3, double> small(std::vector<std::vector<double>>{
+      {0, 2, 0}, {4, 0, 0}, {0, 0, 0.5}});
+  Matrix<3, 3, double> expected(std::vector<std::vector<double>>{
+      {0, 0.25, 0}, {0.5, 0, 0}, {0, 0, 2}});
+  ExpectNear(small.Inverse(), expected, 1e-15);
+}
+
+// Integer inverses exist exactly for determinant +-1.
+TEST(Inverse, Integral) {
+  std::mt19937_64 gen(7);
+  for (int itr = 0; itr < 20; ++itr) {
+    Matrix<6, 6, int64_t> lower = Identity<6, int64_t>();
+    Matrix<6, 6, int64_t> upper = Identity<6, int64_t>();
+    for (size_t row = 0; row < 6; ++row) {
+      for (size_t col = 0; col < row; ++col) {
+        lower(row, col) = static_cast<int64_t>(gen() % 5) - 2;
+        upper(col, row) = static_cast<int64_t>(gen() % 5) - 2;
+      }
+    }
+    upper(2, 2) = -1;
+    Matrix<6, 6, int64_t> matrix = ReferenceProduct(lower, upper);
+    Matrix<6, 6, int64_t> inverse = matrix.Inverse();
+    ASSERT_EQ(ReferenceProduct(matrix, inverse), (Identity<6, int64_t>()));
+    ASSERT_EQ(ReferenceProduct(inverse, matrix), (Identity<6, int64_t>()));
+  }
+  Matrix<2, 2, uint64_t> shear(std::vector<std::vector<uint64_t>>{
+      {1, 1}, {0, 1}});
+  Matrix<2, 2, uint64_t> expected(std::vector<std::vector<uint64_t>>{
+      {1, uint64_t(-1)}, {0, 1}});
+  ASSERT_EQ(shear.Inverse(), expected);
+}
+
+TEST(Inverse, Throws) {
+  Matrix<2, 2, int64_t> scaled(std::vector<std::vector<int64_t>>{
+      {2, 0}, {0, 1}});
+  ASSERT_THROW(scaled.Inverse(), std::domain_error);
+  Matrix<3, 3, int64_t> fractional(std::vector<std::vector<int64_t>>{
+      {2, 1, 0}, {1, 1, 0}, {0, 0, 3}});
+  ASSERT_THROW(fractional.Inverse(), std::domain_error);
+  Matrix<3, 3, int64_t> singular(std::vector<std::vector<int64_t>>{
+      {1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+  ASSERT_THROW(singular.Inverse(), std::domain_error);
+  Matrix<3, 3, double> zero_row(std::vector<std::vector<double>>{
+      {1, 2, 3}, {0, 0, 0}, {7, 8, 9}});
+  ASSERT_THROW(zero_row.Inverse(), std::domain_error);
+}